@@ -0,0 +1,1087 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include "RaptorCLI.h"
+#include "scalar_parser.h"
+
+// Microbenchmarks for the parse and dispatch pipeline. Every stage reports the mean time,
+// heap allocations and heap bytes per operation. Pass a stage name (lexer, value, match,
+// merge, dispatch, register, table, output, layout, batch, pool, wire, execute, journal, script,
+// errors, complete, suggest) to run only that stage. The suggest stage needs -DUSE_SUGGESTIONS.
+
+// Heap usage of the whole process, counted by the replacement operators below.
+static unsigned long gAllocCount = 0;
+static unsigned long gAllocBytes = 0;
+
+void* operator new(size_t size) {
+	gAllocCount++;
+	gAllocBytes += size;
+	void* p = std::malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+// GCC 11+ reports free() inside a replacement operator delete as a mismatched deallocation.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	operator delete(p);
+}
+
+static volatile unsigned long gCallbackHits = 0;
+static volatile unsigned long gErrorHits = 0;
+
+void benchCallback(const Command& cmd) {
+	(void)cmd;
+	gCallbackHits = gCallbackHits + 1;
+}
+
+static void benchInvocationCallback(const Invocation& inv) {
+	(void)inv;
+	gCallbackHits = gCallbackHits + 1;
+}
+
+// Errors of repeated dispatch() go through the callback, as a gateway would log them.
+static void benchErrorCallback(const std::string& msg) {
+	gErrorHits = gErrorHits + msg.size();
+}
+
+// Reaches the private stages of the dispatch pipeline so each one can be timed on its own.
+struct DispatcherBench {
+	Dispatcher& d;
+
+	DispatcherBench(Dispatcher& dispatcher) : d(dispatcher) {}
+
+	Value parseValue(const Token& token) { return d.parseValue(token); }
+	Value parseList(const Token& token) {
+		Value list;
+		d.parseList(token, list);
+		return list;
+	}
+	const Command* matchCommand(const TokenList& tokens, size_t& index) { return d.matchCommand(tokens, index); }
+#ifdef USE_SUGGESTIONS
+	void suggest(const std::string& token, Suggestions& out) { d.commandIndex.suggest(token.data(), token.size(), out); }
+#endif
+
+	// Parse the flags after the command name and bind them in slot order, stopping before the callback.
+	bool merge(const TokenList& tokens, size_t index, const Command& cmd) {
+		ArgumentList parsedArgs((ArenaAllocator<Argument>(&d.arena)));
+		Dispatcher::SlotList slotPositions(cmd.argSpecs.size(), -1, ArenaAllocator<int>(&d.arena));
+		ArgumentList mergedArgs((ArenaAllocator<Argument>(&d.arena)));
+		bool help = false;
+		Dispatcher::CommandSpecs specs(cmd);
+		return d.parseArguments(tokens, index, specs, parsedArgs, slotPositions, help) &&
+			d.bindArguments(specs, parsedArgs, slotPositions, mergedArgs);
+	}
+
+	// Stages called directly bypass the dispatch scope, so the arena is released here.
+	void resetArena() { d.arena.reset(); }
+};
+
+struct Measurement {
+	double ns;
+	double allocs;
+	double bytes;
+};
+
+// Run body(i) for the given number of iterations, after a short warm-up, and return per-op costs.
+template <class F>
+static Measurement measure(size_t iterations, F body) {
+	for (size_t i = 0; i < iterations / 10 + 1; i++) {
+		body(i);
+	}
+	unsigned long allocs = gAllocCount;
+	unsigned long bytes = gAllocBytes;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++) {
+		body(i);
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	Measurement m;
+	m.ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / iterations;
+	m.allocs = (double)(gAllocCount - allocs) / iterations;
+	m.bytes = (double)(gAllocBytes - bytes) / iterations;
+	return m;
+}
+
+static void report(const char* stage, const std::string& label, const Measurement& m) {
+	std::printf("%-8s %-48s %10.1f ns/op %8.2f allocs/op %9.1f B/op\n",
+		stage, label.c_str(), m.ns, m.allocs, m.bytes);
+}
+
+static std::string commandName(size_t i) {
+	char buffer[32];
+	std::sprintf(buffer, "cmd%lu", (unsigned long)i);
+	return std::string(buffer);
+}
+
+static std::string aliasName(size_t i, size_t a) {
+	char buffer[32];
+	std::sprintf(buffer, "c%lua%lu", (unsigned long)i, (unsigned long)a);
+	return std::string(buffer);
+}
+
+static void tokenize(const std::string& input, TokenList& out) {
+	out.clear();
+	Lexer::tokenize(input.data(), input.size(), out);
+}
+
+// Sample inputs, from a two-word switch to an argument-heavy configuration command.
+static const char* const SHORT_INPUT = "led -on true";
+static const char* const TYPICAL_INPUT = "calc -a 1 -b 2.5 -op \"+\"";
+static const char* const HEAVY_INPUT = "configure -i0 1 -i1 2 -i2 3 -i3 4 -d0 0.5 -d1 1.5 -d2 2.5 -d3 3.5 "
+	"-mode fast -label \"a string that is longer than the inline buffer\" -items [1, 2, 3, 4, 5, 6, 7, 8]";
+
+// Register commands that accept the sample inputs, with a realistic mix of argument types,
+// required arguments and defaults.
+static void registerSampleCommands(Dispatcher& d) {
+	Command led("led", "Switch the LED");
+	led.invocationCallback = benchInvocationCallback;
+	led.addArgSpec(ArgSpec("on", VAL_BOOL, true));
+	d.registerCommand(led);
+
+	Command calc("calc", "Calculator");
+	calc.invocationCallback = benchInvocationCallback;
+	calc.addArgSpec(ArgSpec("a", VAL_DOUBLE, true));
+	calc.addArgSpec(ArgSpec("b", VAL_DOUBLE, false, Value(2.5), "Second operand"));
+	calc.addArgSpec(ArgSpec("op", VAL_STRING, false, Value("+"), "Operator"));
+	d.registerCommand(calc);
+
+	Command configure("configure", "Argument-heavy command");
+	configure.invocationCallback = benchInvocationCallback;
+	const char* names[] = { "i0", "i1", "i2", "i3", "d0", "d1", "d2", "d3", "mode", "label", "items" };
+	const ValueType types[] = { VAL_INT, VAL_INT, VAL_INT, VAL_INT, VAL_DOUBLE, VAL_DOUBLE, VAL_DOUBLE, VAL_DOUBLE, VAL_STRING, VAL_STRING, VAL_LIST };
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		configure.addArgSpec(ArgSpec(names[i], types[i]));
+	}
+	configure.addArgSpec(ArgSpec("retries", VAL_INT, false, Value(3), "Retry count"));
+	d.registerCommand(configure);
+}
+
+// The same sample commands as a constant command table.
+static const TableArgSpec LED_ARGS[] = {
+	TABLE_ARG("on", VAL_BOOL, true, TABLE_NO_DEFAULT, ""),
+};
+static const TableArgSpec CALC_ARGS[] = {
+	TABLE_ARG("a", VAL_DOUBLE, true, TABLE_NO_DEFAULT, ""),
+	TABLE_ARG("b", VAL_DOUBLE, false, TABLE_DOUBLE(2.5), "Second operand"),
+	TABLE_ARG("op", VAL_STRING, false, TABLE_STRING("+"), "Operator"),
+};
+static const TableArgSpec CONFIGURE_ARGS[] = {
+	TABLE_ARG("i0", VAL_INT, false, TABLE_NO_DEFAULT, ""),
+	TABLE_ARG("i1", VAL_INT, false, TABLE_NO_DEFAULT, ""),
+	TABLE_ARG("i2", VAL_INT, false, TABLE_NO_DEFAULT, ""),
+	TABLE_ARG("i3", VAL_INT, false, TABLE_NO_DEFAULT, ""),
+	TABLE_ARG("d0", VAL_DOUBLE, false, TABLE_NO_DEFAULT, ""),
+	TABLE_ARG("d1", VAL_DOUBLE, false, TABLE_NO_DEFAULT, ""),
+	TABLE_ARG("d2", VAL_DOUBLE, false, TABLE_NO_DEFAULT, ""),
+	TABLE_ARG("d3", VAL_DOUBLE, false, TABLE_NO_DEFAULT, ""),
+	TABLE_ARG("mode", VAL_STRING, false, TABLE_NO_DEFAULT, ""),
+	TABLE_ARG("label", VAL_STRING, false, TABLE_NO_DEFAULT, ""),
+	TABLE_ARG("items", VAL_LIST, false, TABLE_NO_DEFAULT, ""),
+	TABLE_ARG("retries", VAL_INT, false, TABLE_INT(3), "Retry count"),
+};
+static const TableCommand SAMPLE_TABLE[] = {
+	TABLE_COMMAND("led", "Switch the LED", benchInvocationCallback, TABLE_NONE, TABLE_ARGS(LED_ARGS), TABLE_NONE),
+	TABLE_COMMAND("calc", "Calculator", benchInvocationCallback, TABLE_NONE, TABLE_ARGS(CALC_ARGS), TABLE_NONE),
+	TABLE_COMMAND("configure", "Argument-heavy command", benchInvocationCallback, TABLE_NONE, TABLE_ARGS(CONFIGURE_ARGS), TABLE_NONE),
+};
+
+// Build a dispatcher with `count` top-level commands, each with `aliases` aliases
+// and a chain of `depth` nested subcommands.
+static void buildTree(Dispatcher& d, size_t count, size_t aliases, size_t depth) {
+	for (size_t i = 0; i < count; i++) {
+		Command cmd(commandName(i), "Generated command");
+		cmd.callback = benchCallback;
+		for (size_t a = 0; a < aliases; a++) {
+			cmd.addAlias(aliasName(i, a));
+		}
+		// Build the subcommand chain bottom-up, moving each node into its parent.
+		Command child;
+		for (size_t level = depth; level > 0; level--) {
+			Command node(commandName(level - 1), "Generated subcommand");
+			node.callback = benchCallback;
+			if (level < depth) {
+				node.addSubcommand(std::move(child));
+			}
+			child = std::move(node);
+		}
+		if (depth > 0) {
+			cmd.addSubcommand(std::move(child));
+		}
+		d.registerCommand(std::move(cmd));
+	}
+}
+
+static void benchLexer() {
+	const size_t iterations = 500000;
+	const std::string inputs[] = { SHORT_INPUT, TYPICAL_INPUT, HEAVY_INPUT };
+	const char* labels[] = { "tokenize short (3 tokens)", "tokenize typical (7 tokens)", "tokenize heavy (23 tokens)" };
+	TokenList tokens;
+	for (size_t i = 0; i < 3; i++) {
+		const std::string& input = inputs[i];
+		report("lexer", labels[i], measure(iterations, [&](size_t) { tokenize(input, tokens); }));
+	}
+
+	const std::string script = "led -on true; calc -a 1 -op \"a;b\"; configure -items [1;2]; calc -a 2";
+	TokenList spans;
+	report("lexer", "splitCommands (4 commands)", measure(iterations, [&](size_t) {
+		spans.clear();
+		Lexer::splitCommands(script.data(), script.size(), spans);
+	}));
+}
+
+static void benchValues() {
+	const size_t iterations = 500000;
+	Dispatcher d;
+	DispatcherBench bench(d);
+	const std::string input = "42 -3.25 true word \"a quoted string longer than inline\"";
+	const char* labels[] = { "parseValue int", "parseValue double", "parseValue bool", "parseValue word",
+		"parseValue quoted long string" };
+	TokenList tokens;
+	tokenize(input, tokens);
+	for (size_t i = 0; i < tokens.size(); i++) {
+		const Token& token = tokens[i];
+		report("value", labels[i], measure(iterations, [&](size_t) {
+			gCallbackHits = gCallbackHits + bench.parseValue(token).type;
+			bench.resetArena();
+		}));
+	}
+
+	// Sensor configuration lists: calibration tables of doubles and threshold tables of ints.
+	std::string calibration = "[", thresholds = "[";
+	char number[32];
+	for (int i = 0; i < 32; i++) {
+		std::sprintf(number, "%s%.4f", i ? ", " : "", (i - 16) * 0.3125 + 0.0001 * i);
+		calibration += number;
+	}
+	for (int i = 0; i < 64; i++) {
+		std::sprintf(number, "%s%d", i ? ", " : "", (i - 32) * 1337);
+		thresholds += number;
+	}
+	const std::string lists = "[1, 2.5, \"a,b\", x] [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16] " +
+		calibration + "] " + thresholds + "]";
+	const char* listLabels[] = { "parseList mixed (4 items)", "parseList ints (16 items)",
+		"parseList calibration (32 doubles)", "parseList thresholds (64 ints)" };
+	tokenize(lists, tokens);
+	for (size_t i = 0; i < tokens.size(); i++) {
+		const Token& token = tokens[i];
+		report("value", listLabels[i], measure(iterations / 4, [&](size_t) {
+			gCallbackHits = gCallbackHits + bench.parseList(token).listValue.size();
+			bench.resetArena();
+		}));
+	}
+
+	// Large flat and matrix-shaped lists, to show that parsing stays linear in the input size.
+	const size_t sizes[] = { 1000, 10000 };
+	for (size_t n = 0; n < 2; n++) {
+		size_t count = sizes[n];
+		size_t rows = count == 1000 ? 10 : 100;
+		std::string flat = "[", matrix = "[";
+		for (size_t i = 0; i < count; i++) {
+			std::sprintf(number, "%s%d", i ? ", " : "", (int)(i * 7) - 5000);
+			flat += number;
+		}
+		for (size_t r = 0; r < rows; r++) {
+			matrix += r ? ", [" : "[";
+			for (size_t c = 0; c < count / rows; c++) {
+				std::sprintf(number, "%s%.3f", c ? ", " : "", r * 0.5 + c * 0.125);
+				matrix += number;
+			}
+			matrix += "]";
+		}
+		flat += "]";
+		matrix += "]";
+		const std::string* large[] = { &flat, &matrix };
+		for (size_t k = 0; k < 2; k++) {
+			Token token(large[k]->data(), large[k]->size(), TOKEN_LIST);
+			char label[64];
+			if (k == 0)
+				std::sprintf(label, "parseList flat (%lu ints, %lu bytes)", (unsigned long)count, (unsigned long)flat.size());
+			else
+				std::sprintf(label, "parseList matrix (%lux%lu, %lu bytes)", (unsigned long)rows, (unsigned long)(count / rows),
+					(unsigned long)matrix.size());
+			report("value", label, measure(10000000 / (count * 10), [&](size_t) {
+				gCallbackHits = gCallbackHits + bench.parseList(token).listValue.size();
+				bench.resetArena();
+			}));
+		}
+	}
+}
+
+// The classifier before parseScalar: strtol, then strtod, then the bool words, on a terminated copy.
+static ValueType legacyClassify(const char* token, size_t length) {
+	char text[64];
+	std::memcpy(text, token, length);
+	text[length] = '\0';
+	char* endptr = 0;
+	long intValue = std::strtol(text, &endptr, 10);
+	if (endptr != text && *endptr == '\0')
+		return (ValueType)(VAL_INT + (intValue & 0));
+	double doubleValue = std::strtod(text, &endptr);
+	if (endptr != text && *endptr == '\0')
+		return (ValueType)(VAL_DOUBLE + (doubleValue != doubleValue));
+	if (length == 4 && std::memcmp(token, "true", 4) == 0)
+		return VAL_BOOL;
+	if (length == 5 && std::memcmp(token, "false", 5) == 0)
+		return VAL_BOOL;
+	return VAL_STRING;
+}
+
+// Compare the one-pass classifier with the legacy one on numeric-heavy token mixes.
+static void benchClassifier() {
+	const size_t iterations = 200000;
+	const char* mixes[] = {
+		"12 -7 1024 65535 -32768 0 3 99",
+		"0.125 -3.5 12.75 1e-3 6.02e23 -0.0625 100.5 2.5",
+		"12 0.5 true fast -3 auto 1.25e2 off",
+		"2147483648 -9999999999 123456789012 1e400"
+	};
+	const char* labels[] = { "8 ints", "8 doubles", "mixed ints, doubles, words", "overflowing ints" };
+	for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); m++) {
+		std::string input = mixes[m];
+		TokenList tokens;
+		tokenize(input, tokens);
+		std::string label = std::string("parseScalar ") + labels[m];
+		report("value", label, measure(iterations, [&](size_t) {
+			Scalar scalar;
+			for (size_t i = 0; i < tokens.size(); i++) {
+				gCallbackHits = gCallbackHits + parseScalar(tokens[i].data, tokens[i].length, scalar);
+			}
+		}));
+		label = std::string("strtol/strtod ") + labels[m];
+		report("value", label, measure(iterations, [&](size_t) {
+			for (size_t i = 0; i < tokens.size(); i++) {
+				gCallbackHits = gCallbackHits + legacyClassify(tokens[i].data, tokens[i].length);
+			}
+		}));
+	}
+}
+
+// Time command lookup and end-to-end dispatch by name and by alias in a generated tree.
+static void benchMatch(size_t count, size_t aliases, size_t depth) {
+	Dispatcher d;
+	DispatcherBench bench(d);
+	buildTree(d, count, aliases, depth);
+
+	std::vector<std::string> byName, byAlias;
+	for (size_t i = 0; i < 64; i++) {
+		size_t target = (i * 7919) % count;
+		std::string path = commandName(target);
+		std::string aliasPath = aliases ? aliasName(target, aliases - 1) : path;
+		for (size_t level = 0; level < depth; level++) {
+			path += " " + commandName(level);
+			aliasPath += " " + commandName(level);
+		}
+		byName.push_back(path);
+		byAlias.push_back(aliasPath);
+	}
+	std::vector<TokenList> nameTokens(byName.size()), aliasTokens(byAlias.size());
+	for (size_t i = 0; i < byName.size(); i++) {
+		tokenize(byName[i], nameTokens[i]);
+		tokenize(byAlias[i], aliasTokens[i]);
+	}
+
+	char label[64];
+	const size_t iterations = 200000;
+	std::sprintf(label, "matchCommand n=%lu aliases=%lu depth=%lu name",
+		(unsigned long)count, (unsigned long)aliases, (unsigned long)depth);
+	report("match", label, measure(iterations, [&](size_t i) {
+		size_t index = 0;
+		gCallbackHits = gCallbackHits + (bench.matchCommand(nameTokens[i % 64], index) != 0);
+	}));
+	std::sprintf(label, "matchCommand n=%lu aliases=%lu depth=%lu alias",
+		(unsigned long)count, (unsigned long)aliases, (unsigned long)depth);
+	report("match", label, measure(iterations, [&](size_t i) {
+		size_t index = 0;
+		gCallbackHits = gCallbackHits + (bench.matchCommand(aliasTokens[i % 64], index) != 0);
+	}));
+	std::sprintf(label, "dispatch n=%lu aliases=%lu depth=%lu name",
+		(unsigned long)count, (unsigned long)aliases, (unsigned long)depth);
+	report("dispatch", label, measure(iterations, [&](size_t i) { d.dispatch(byName[i % 64]); }));
+}
+
+static void benchMerge() {
+	const size_t iterations = 200000;
+	Dispatcher d;
+	DispatcherBench bench(d);
+	registerSampleCommands(d);
+	const std::string inputs[] = { SHORT_INPUT, TYPICAL_INPUT, HEAVY_INPUT };
+	const char* labels[] = { "parse+bind 1 argument", "parse+bind 3 arguments, 1 default", "parse+bind 11 arguments, 1 default" };
+	for (size_t i = 0; i < 3; i++) {
+		TokenList tokens;
+		tokenize(inputs[i], tokens);
+		size_t index = 0;
+		const Command* cmd = bench.matchCommand(tokens, index);
+		report("merge", labels[i], measure(iterations, [&](size_t) {
+			gCallbackHits = gCallbackHits + bench.merge(tokens, index, *cmd);
+			bench.resetArena();
+		}));
+	}
+
+	const char* dispatchLabels[] = { "dispatch short", "dispatch typical", "dispatch heavy" };
+	for (size_t i = 0; i < 3; i++) {
+		const std::string& input = inputs[i];
+		report("dispatch", dispatchLabels[i], measure(iterations, [&](size_t) { d.dispatch(input); }));
+	}
+}
+
+// Startup cost of a large generated command set, per registered command.
+static void benchRegister(size_t count) {
+	Measurement m = measure(3, [&](size_t) {
+		Dispatcher d;
+		buildTree(d, count, 4, 2);
+		d.freeze();
+	});
+	m.ns /= count;
+	m.allocs /= count;
+	m.bytes /= count;
+	char label[64];
+	std::sprintf(label, "build+register+freeze n=%lu aliases=4 depth=2", (unsigned long)count);
+	report("register", label, m);
+}
+
+// Compare building the sample commands at startup with registering them as a table, and
+// dispatching against each.
+static void benchTable() {
+	const size_t iterations = 200000;
+	report("table", "construct + register 3 commands", measure(iterations / 20, [&](size_t) {
+		Dispatcher d;
+		registerSampleCommands(d);
+	}));
+	report("table", "construct + registerTable 3 commands", measure(iterations / 20, [&](size_t) {
+		Dispatcher d;
+		d.registerTable(SAMPLE_TABLE);
+	}));
+	Dispatcher registered, table;
+	registerSampleCommands(registered);
+	table.registerTable(SAMPLE_TABLE);
+	const std::string inputs[] = { SHORT_INPUT, TYPICAL_INPUT, HEAVY_INPUT };
+	const char* labels[] = { "short", "typical", "heavy" };
+	for (size_t i = 0; i < 3; i++) {
+		const std::string& input = inputs[i];
+		report("table", std::string("dispatch registered ") + labels[i], measure(iterations, [&](size_t) { registered.dispatch(input); }));
+		report("table", std::string("dispatch table ") + labels[i], measure(iterations, [&](size_t) { table.dispatch(input); }));
+	}
+}
+
+// Writes every line to a file descriptor as it is printed, like std::cout with std::endl.
+struct LineCLIOutput : CLIOutput {
+	int fd;
+	unsigned long writes;
+
+	explicit LineCLIOutput(int target) : fd(target), writes(0) {}
+	void print(const std::string& s) override { write(s.data(), s.size()); }
+	void println(const std::string& s) override { print(s + "\n"); }
+	void println() override { write("\n", 1); }
+	void write(const char* data, size_t length) override {
+		writes++;
+		gCallbackHits = gCallbackHits + (::write(fd, data, length) > 0);
+	}
+};
+
+// A BufferedCLIOutput that sends its writes to a file descriptor and counts them.
+struct CountingCLIOutput : BufferedCLIOutput {
+	int fd;
+	unsigned long writes;
+
+	CountingCLIOutput(int target, size_t bytes) : BufferedCLIOutput(bytes), fd(target), writes(0) {}
+	~CountingCLIOutput() { flush(); }
+protected:
+	void sink(const char* first, size_t firstLength, const char* second, size_t secondLength) override {
+		writes++;
+		gCallbackHits = gCallbackHits + (::write(fd, first, firstLength) > 0);
+		if (secondLength)
+			gCallbackHits = gCallbackHits + (::write(fd, second, secondLength) > 0);
+	}
+};
+
+// Print the help of a 1,000-command tree to /dev/null, line by line and through a buffer.
+static void benchOutput() {
+	Dispatcher d;
+	for (size_t i = 0; i < 1000; i++) {
+		Command cmd(commandName(i), "Generated command");
+		cmd.addAlias(aliasName(i, 0));
+		cmd.addArgSpec(ArgSpec("level", VAL_INT, true, "Level to set"));
+		cmd.addArgSpec(ArgSpec("mode", VAL_STRING, false, Value("auto"), "Mode"));
+		d.registerCommand(std::move(cmd));
+	}
+	int fd = ::open("/dev/null", O_WRONLY);
+	LineCLIOutput lines(fd);
+	d.registerOutput(&lines);
+	Measurement m = measure(20, [&](size_t) { d.printGlobalHelp(); });
+	lines.writes = 0;
+	d.printGlobalHelp();
+	char label[96];
+	std::sprintf(label, "help 1000 commands, a write per line (%lu writes)", lines.writes);
+	report("output", label, m);
+	const size_t sizes[] = { 1024, 16384 };
+	for (size_t i = 0; i < 2; i++) {
+		CountingCLIOutput buffered(fd, sizes[i]);
+		d.registerOutput(&buffered);
+		m = measure(20, [&](size_t) { d.printGlobalHelp(); });
+		buffered.writes = 0;
+		d.printGlobalHelp();
+		std::sprintf(label, "help 1000 commands, %lu B buffer (%lu writes)", (unsigned long)sizes[i], buffered.writes);
+		report("output", label, m);
+	}
+	d.registerOutput(0);
+	::close(fd);
+}
+
+// The Value layout before the tagged union, kept here to compare against.
+struct LegacyValue {
+	ValueType type;
+	int intValue;
+	double doubleValue;
+	bool boolValue;
+	std::string stringValue;
+	std::vector<LegacyValue> listValue;
+
+	LegacyValue() : type(VAL_NONE), intValue(0), doubleValue(0.0), boolValue(false) {}
+	LegacyValue(int v) : type(VAL_INT), intValue(v), doubleValue(0.0), boolValue(false) {}
+	LegacyValue(double v) : type(VAL_DOUBLE), intValue(0), doubleValue(v), boolValue(false) {}
+	LegacyValue(const char* v) : type(VAL_STRING), intValue(0), doubleValue(0.0), boolValue(false), stringValue(v) {}
+	LegacyValue(const std::vector<LegacyValue>& v) : type(VAL_LIST), intValue(0), doubleValue(0.0), boolValue(false), listValue(v) {}
+};
+
+// Build the values of an argument-heavy command: scalars, short and long strings and a list,
+// then copy the set the way the dispatcher hands arguments around.
+template <class V>
+static size_t buildArgumentSet(std::vector<V>& out) {
+	out.clear();
+	for (int i = 0; i < 4; i++) {
+		out.push_back(V(i * 17));
+		out.push_back(V(i * 0.25));
+	}
+	out.push_back(V("fast"));
+	out.push_back(V("mode"));
+	out.push_back(V("a string that is longer than the inline buffer"));
+	std::vector<V> items;
+	for (int i = 0; i < 8; i++) {
+		items.push_back(V(i));
+	}
+	out.push_back(V(items));
+	std::vector<V> copy(out);
+	return copy.size();
+}
+
+static void benchValueLayout() {
+	const size_t iterations = 200000;
+	std::printf("layout   sizeof(Value)=%lu  sizeof(LegacyValue)=%lu\n",
+		(unsigned long)sizeof(Value), (unsigned long)sizeof(LegacyValue));
+	std::vector<Value> values;
+	report("layout", "12-argument set build+copy, tagged union", measure(iterations, [&](size_t) {
+		gCallbackHits = gCallbackHits + (buildArgumentSet(values) & 1);
+	}));
+	std::vector<LegacyValue> legacyValues;
+	report("layout", "12-argument set build+copy, legacy", measure(iterations, [&](size_t) {
+		gCallbackHits = gCallbackHits + (buildArgumentSet(legacyValues) & 1);
+	}));
+}
+
+// Replay a log of field commands, one in ten of them invalid, with repeated dispatch()
+// and with both forms of dispatchBatch().
+static void benchBatch(size_t lineCount) {
+	Dispatcher d;
+	d.registerErrorCallback(benchErrorCallback);
+	buildTree(d, 100, 0, 0);
+	Command report("report", "Node report");
+	report.callback = benchCallback;
+	report.addArgSpec(ArgSpec("node", VAL_INT, true));
+	report.addArgSpec(ArgSpec("temp", VAL_DOUBLE));
+	report.addArgSpec(ArgSpec("status", VAL_STRING));
+	d.registerCommand(report);
+
+	std::vector<std::string> lines;
+	std::string buffer;
+	char line[96];
+	for (size_t i = 0; i < lineCount; i++) {
+		if (i % 10 == 9)
+			std::sprintf(line, "report -temp %lu.5", (unsigned long)(i % 40));
+		else if (i % 2)
+			std::sprintf(line, "report -node %lu -temp %lu.5 -status \"ok\"", (unsigned long)i, (unsigned long)(i % 40));
+		else
+			std::sprintf(line, "cmd%lu", (unsigned long)(i % 100));
+		lines.push_back(line);
+		buffer += line;
+		buffer += '\n';
+	}
+
+	const size_t rounds = 20;
+	std::vector<DispatchResult> results;
+	Measurement single = measure(rounds, [&](size_t) {
+		for (size_t i = 0; i < lines.size(); i++) {
+			d.dispatch(lines[i]);
+		}
+	});
+	Measurement batchLines = measure(rounds, [&](size_t) { d.dispatchBatch(lines, results); });
+	Measurement batchBuffer = measure(rounds, [&](size_t) { d.dispatchBatch(buffer.data(), buffer.size(), results); });
+
+	// Report per command rather than per replay of the whole log.
+	Measurement* all[] = { &single, &batchLines, &batchBuffer };
+	for (size_t i = 0; i < 3; i++) {
+		all[i]->ns /= lineCount;
+		all[i]->allocs /= lineCount;
+		all[i]->bytes /= lineCount;
+	}
+	char label[64];
+	std::sprintf(label, "replay %lu lines, dispatch()", (unsigned long)lineCount);
+	::report("batch", label, single);
+	std::sprintf(label, "replay %lu lines, dispatchBatch(lines)", (unsigned long)lineCount);
+	::report("batch", label, batchLines);
+	std::sprintf(label, "replay %lu lines, dispatchBatch(buffer)", (unsigned long)lineCount);
+	::report("batch", label, batchBuffer);
+	std::printf("batch    throughput  dispatch(): %.0f cmd/s  dispatchBatch(lines): %.0f cmd/s  dispatchBatch(buffer): %.0f cmd/s\n",
+		1e9 / single.ns, 1e9 / batchLines.ns, 1e9 / batchBuffer.ns);
+}
+
+// Throughput of a DispatchPool fed by 8 connections, each with its commands kept in order.
+static void benchPool(size_t workers) {
+	Dispatcher d;
+	registerSampleCommands(d);
+	const std::string inputs[] = { SHORT_INPUT, TYPICAL_INPUT, HEAVY_INPUT };
+	const size_t commands = 20000;
+	DispatchPool pool(d, workers);
+	Measurement m = measure(5, [&](size_t) {
+		for (size_t i = 0; i < commands; i++) {
+			pool.submit(inputs[i % 3], (uint32_t)(i % 8 + 1));
+		}
+		pool.wait();
+	});
+	m.ns /= commands;
+	m.allocs /= commands;
+	m.bytes /= commands;
+	char label[64];
+	std::sprintf(label, "pool workers=%lu, 8 ordered connections", (unsigned long)pool.getWorkerCount());
+	report("pool", label, m);
+}
+
+// Frame size and receive cost of the sample commands as text and as binary frames.
+static void benchWire() {
+	Dispatcher d;
+	registerSampleCommands(d);
+	d.freeze();
+	std::vector<Value> items;
+	for (int i = 1; i <= 8; i++) {
+		items.push_back(Value(i));
+	}
+	ExecutableCommand commands[] = {
+		ExecutableCommand(*d.findCommand("led"), { { "on", Value(true) } }),
+		ExecutableCommand(*d.findCommand("calc"), { { "a", Value(1) }, { "b", Value(2.5) }, { "op", Value("+") } }),
+		ExecutableCommand(*d.findCommand("configure"), { { "i0", Value(1) }, { "i1", Value(2) }, { "i2", Value(3) },
+			{ "i3", Value(4) }, { "d0", Value(0.5) }, { "d1", Value(1.5) }, { "d2", Value(2.5) }, { "d3", Value(3.5) },
+			{ "mode", Value("fast") }, { "label", Value("a string that is longer than the inline buffer") },
+			{ "items", Value(items) } }),
+	};
+	const char* names[] = { "led", "calc", "configure" };
+	for (size_t i = 0; i < 3; i++) {
+		std::string text = commands[i].toString();
+		uint8_t frame[256];
+		size_t frameSize = commands[i].encode(frame, sizeof(frame));
+		std::printf("wire     %-10s text %3lu bytes, frame %3lu bytes (%.1fx smaller)\n", names[i],
+			(unsigned long)text.size(), (unsigned long)frameSize, (double)text.size() / frameSize);
+		char label[64];
+		std::sprintf(label, "%s, dispatch(text)", names[i]);
+		report("wire", label, measure(200000, [&](size_t) { d.dispatch(text); }));
+		std::sprintf(label, "%s, dispatchFrame", names[i]);
+		report("wire", label, measure(200000, [&](size_t) { d.dispatchFrame(frame, frameSize); }));
+	}
+}
+
+// Running preset commands, one at a time and as a sequence, against the registered tree.
+static void benchExecute() {
+	Dispatcher d;
+	registerSampleCommands(d);
+	Command legacy("legacy", "Legacy callback");
+	legacy.callback = benchCallback;
+	legacy.addArgSpec(ArgSpec("n", VAL_INT));
+	d.registerCommand(legacy);
+	d.freeze();
+	ExecutableCommand calc(*d.findCommand("calc"), { { "a", Value(1.0) }, { "op", Value("a string longer than inline") } });
+	ExecutableCommand led(*d.findCommand("led"), { { "on", Value(true) } });
+	ExecutableCommand old(*d.findCommand("legacy"), { { "n", Value(7) } });
+	CommandSequence sequence;
+	sequence.addCommand(calc);
+	sequence.addCommand(led);
+	sequence.addCommand(old);
+	report("execute", "ExecutableCommand::execute (invocation)", measure(1000000, [&](size_t) { calc.execute(); }));
+	report("execute", "ExecutableCommand::execute (legacy)", measure(1000000, [&](size_t) { old.execute(); }));
+	report("execute", "ExecutableCommand::executeWithArgs", measure(1000000, [&](size_t) {
+		calc.executeWithArgs({ { "a", Value(2.0) }, { "b", Value(3.0) } });
+	}));
+	report("execute", "CommandSequence::execute, 3 commands", measure(1000000, [&](size_t) { sequence.execute(); }));
+}
+
+// Recording the sample commands into a mapped journal file, and replaying the journal compared
+// with dispatching the same commands as text again.
+static void benchJournal(size_t commandCount) {
+	Dispatcher d;
+	registerSampleCommands(d);
+	d.freeze();
+	char path[] = "/tmp/raptorcli-journal-XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0)
+		return;
+	::close(fd);
+	unlink(path);
+	CommandJournal journal;
+	if (!journal.open(path, commandCount * 128 + 4096))
+		return;
+	const std::string inputs[] = { SHORT_INPUT, TYPICAL_INPUT, HEAVY_INPUT };
+	Measurement plain = measure(commandCount, [&](size_t i) { d.dispatch(inputs[i % 3]); });
+	d.setJournal(&journal);
+	Measurement recorded = measure(commandCount, [&](size_t i) { d.dispatch(inputs[i % 3]); });
+	d.setJournal(0);
+	journal.commit();
+	size_t records = journal.getRecords();
+	Measurement replayed = measure(1, [&](size_t) { d.replay(journal); });
+	replayed.ns /= records;
+	replayed.allocs /= records;
+	replayed.bytes /= records;
+	char label[64];
+	std::sprintf(label, "dispatch, no journal");
+	report("journal", label, plain);
+	std::sprintf(label, "dispatch, journaled (group of %d)", JOURNAL_DEFAULT_GROUP_SIZE);
+	report("journal", label, recorded);
+	std::sprintf(label, "replay %lu records", (unsigned long)records);
+	report("journal", label, replayed);
+	std::printf("journal  %.1f bytes/record, replay %.0f cmd/s\n", (double)journal.getUsed() / records, 1e9 / replayed.ns);
+	journal.close();
+	unlink(path);
+}
+
+// A provisioning script of sample commands, run line by line through std::string and dispatch()
+// and in place with ScriptRunner, from memory and from a mapped file.
+static void benchScript(size_t lineCount) {
+	Dispatcher d;
+	registerSampleCommands(d);
+	const char* inputs[] = { SHORT_INPUT, TYPICAL_INPUT, HEAVY_INPUT };
+	std::string script;
+	for (size_t i = 0; i < lineCount; i++) {
+		script += inputs[i % 3];
+		script += '\n';
+	}
+	char path[] = "/tmp/raptorcli-script-XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0)
+		return;
+	bool written = write(fd, script.data(), script.size()) == (ssize_t)script.size();
+	::close(fd);
+
+	Measurement lines = measure(5, [&](size_t) {
+		size_t begin = 0;
+		while (begin < script.size()) {
+			size_t end = script.find('\n', begin);
+			std::string line = script.substr(begin, end - begin);
+			d.dispatch(line);
+			begin = end + 1;
+		}
+	});
+	ScriptRunner runner(d);
+	Measurement inPlace = measure(5, [&](size_t) { runner.run(script.data(), script.size()); });
+	Measurement mapped = measure(5, [&](size_t) { runner.runFile(path); });
+	unlink(path);
+
+	Measurement* all[] = { &lines, &inPlace, &mapped };
+	for (size_t i = 0; i < 3; i++) {
+		all[i]->ns /= lineCount;
+		all[i]->allocs /= lineCount;
+		all[i]->bytes /= lineCount;
+	}
+	char label[64];
+	std::sprintf(label, "%lu lines, std::string per line + dispatch()", (unsigned long)lineCount);
+	report("script", label, lines);
+	std::sprintf(label, "%lu lines, ScriptRunner::run", (unsigned long)lineCount);
+	report("script", label, inPlace);
+	if (written) {
+		std::sprintf(label, "%lu lines, ScriptRunner::runFile", (unsigned long)lineCount);
+		report("script", label, mapped);
+	}
+}
+
+// A flood of malformed commands, as from a noisy radio link, reported to the string error
+// callback, to a structured error handler, and to a handler that renders each error's text.
+// Successful dispatches of the same commands are the baseline.
+static void benchErrors() {
+	Dispatcher d;
+	registerSampleCommands(d);
+	d.freeze();
+	const char* valid[] = { "led -on true", "calc -a 1 -b 2.5", "configure -i0 1 -d0 0.5 -label x" };
+	const char* malformed[] = { "lde -on true", "calc -a one -b 2.5", "configure -i0 1 -d0 0.5 -lable x" };
+	char label[64];
+	report("errors", "valid commands", measure(300000, [&](size_t i) { d.dispatch(valid[i % 3], std::strlen(valid[i % 3])); }));
+
+	d.registerErrorCallback(benchErrorCallback);
+	std::sprintf(label, "malformed, error callback (%s)",
+#ifdef USE_DESCRIPTIVE_ERRORS
+		"output"
+#else
+		"code"
+#endif
+	);
+	report("errors", label, measure(300000, [&](size_t i) { d.dispatch(malformed[i % 3], std::strlen(malformed[i % 3])); }));
+
+	d.registerErrorHandler([](const CLIError& error) { gErrorHits = gErrorHits + error.code + error.offset; });
+	report("errors", "malformed, error handler", measure(300000, [&](size_t i) {
+		d.dispatch(malformed[i % 3], std::strlen(malformed[i % 3]));
+	}));
+
+	d.registerErrorHandler([](const CLIError& error) {
+		char text[96];
+		gErrorHits = gErrorHits + error.render(text, sizeof(text));
+	});
+	report("errors", "malformed, error handler + render()", measure(300000, [&](size_t i) {
+		d.dispatch(malformed[i % 3], std::strlen(malformed[i % 3]));
+	}));
+}
+
+// Counts the bytes written, to compare the size of responses.
+struct SizeCLIOutput : CLIOutput {
+	unsigned long bytes;
+
+	SizeCLIOutput() : bytes(0) {}
+	void print(const std::string& s) override { bytes += s.size(); }
+	void println(const std::string& s) override { bytes += s.size() + 1; }
+	void println() override { bytes++; }
+	void write(const char*, size_t length) override { bytes += length; }
+};
+
+// Tab completion on every keystroke of a long line, resuming from the previous keystroke and,
+// for comparison, lexing the whole line each time. Then the size of the response to a tab
+// after a command prefix against the global help a console would print instead.
+static void benchComplete() {
+	Dispatcher d;
+	buildTree(d, 1000, 1, 0);
+	registerSampleCommands(d);
+	d.freeze();
+	std::string line = std::string(HEAVY_INPUT) + "; " + HEAVY_INPUT;
+	Completer completer(d);
+	size_t found = 0;
+	for (size_t i = 1; i <= line.size(); i++) {
+		found += completer.complete(line.data(), i, i);
+	}
+
+	char label[96];
+	Measurement typed = measure(20, [&](size_t) {
+		for (size_t i = 1; i <= line.size(); i++) {
+			gCallbackHits = gCallbackHits + completer.complete(line.data(), i, i);
+		}
+	});
+	Measurement fresh = measure(20, [&](size_t) {
+		for (size_t i = 1; i <= line.size(); i++) {
+			completer.reset();
+			gCallbackHits = gCallbackHits + completer.complete(line.data(), i, i);
+		}
+	});
+	Measurement* all[] = { &typed, &fresh };
+	for (size_t i = 0; i < 2; i++) {
+		all[i]->ns /= line.size();
+		all[i]->allocs /= line.size();
+		all[i]->bytes /= line.size();
+	}
+	std::sprintf(label, "per keystroke, %lu chars (%lu candidates)", (unsigned long)line.size(), (unsigned long)found);
+	report("complete", label, typed);
+	std::sprintf(label, "per keystroke, reset() each time");
+	report("complete", label, fresh);
+
+	SizeCLIOutput size;
+	completer.complete("cmd99", 5, 5);
+	completer.print(&size);
+	std::sprintf(label, "tab after \"cmd99\" (%lu candidates, %lu B)", (unsigned long)completer.getCompletions().size(), size.bytes);
+	report("complete", label, measure(100000, [&](size_t) {
+		completer.reset();
+		gCallbackHits = gCallbackHits + completer.complete("cmd99", 5, 5);
+	}));
+	size.bytes = 0;
+	d.registerOutput(&size);
+	d.printGlobalHelp();
+	d.registerOutput(0);
+	std::sprintf(label, "global help instead (%lu B)", size.bytes);
+	report("complete", label, measure(20, [&](size_t) {
+		SizeCLIOutput discard;
+		d.registerOutput(&discard);
+		d.printGlobalHelp();
+		d.registerOutput(0);
+	}));
+}
+
+#ifdef USE_SUGGESTIONS
+// Generated names read like words rather than numbered, so that typos have a few near neighbours
+// as in a real tree, not thousands.
+static std::string wordName(size_t i) {
+	static const char CONSONANTS[] = "bcdfghklmnprstvwz";
+	static const char VOWELS[] = "aeiou";
+	std::string name;
+	uint32_t x = (uint32_t)i * 2654435761u + 12345;
+	size_t syllables = 2 + i % 3;
+	for (size_t s = 0; s < syllables; s++) {
+		x = x * 1103515245u + 12345;
+		name += CONSONANTS[(x >> 16) % 17];
+		name += VOWELS[(x >> 8) % 5];
+		if ((x >> 4) % 3 == 0)
+			name += CONSONANTS[(x >> 20) % 17];
+	}
+	return name + (char)('a' + i % 26);
+}
+
+// Levenshtein distance, as a scan over every name would compute it.
+static size_t scanDistance(const std::string& a, const std::string& b) {
+	std::vector<size_t> row(b.size() + 1);
+	for (size_t j = 0; j <= b.size(); j++)
+		row[j] = j;
+	for (size_t i = 1; i <= a.size(); i++) {
+		size_t diagonal = row[0];
+		row[0] = i;
+		for (size_t j = 1; j <= b.size(); j++) {
+			size_t above = row[j];
+			row[j] = std::min(std::min(row[j] + 1, row[j - 1] + 1), diagonal + (a[i - 1] == b[j - 1] ? 0 : 1));
+			diagonal = above;
+		}
+	}
+	return row[b.size()];
+}
+
+// "Did you mean" lookups for misspelt commands in a tree of `count` commands, through the
+// trigram index and, for comparison, by scanning every name. Known commands are dispatched
+// too, to show the success path is unchanged.
+static void benchSuggest(size_t count) {
+	Dispatcher d;
+	DispatcherBench bench(d);
+	d.registerErrorCallback(benchErrorCallback);
+	std::vector<std::string> names;
+	for (size_t i = 0; i < count; i++) {
+		names.push_back(wordName(i));
+		Command cmd(names.back(), "Generated command");
+		cmd.invocationCallback = benchInvocationCallback;
+		d.registerCommand(std::move(cmd));
+	}
+	d.freeze();
+	// A swap, a substitution, a deletion and an insertion, in turn.
+	std::vector<std::string> typos;
+	for (size_t i = 0; i < 64; i++) {
+		std::string typo = names[(i * 7919) % count];
+		size_t at = typo.size() / 2;
+		switch (i % 4) {
+		case 0: std::swap(typo[at], typo[at + 1]); break;
+		case 1: typo[at] = 'x'; break;
+		case 2: typo.erase(at, 1); break;
+		default: typo.insert(at, 1, 'e'); break;
+		}
+		typos.push_back(typo);
+	}
+	size_t found = 0;
+	Suggestions suggestions;
+	for (size_t i = 0; i < typos.size(); i++) {
+		bench.suggest(typos[i], suggestions);
+		found += suggestions.count > 0;
+	}
+
+	char label[64];
+	std::sprintf(label, "suggest index n=%lu (%lu/64 found)", (unsigned long)count, (unsigned long)found);
+	report("suggest", label, measure(100000, [&](size_t i) {
+		bench.suggest(typos[i % 64], suggestions);
+		gCallbackHits = gCallbackHits + suggestions.count;
+	}));
+	std::sprintf(label, "suggest linear scan n=%lu", (unsigned long)count);
+	report("suggest", label, measure(20000000 / count, [&](size_t i) {
+		size_t best = 0;
+		for (size_t j = 0; j < names.size(); j++) {
+			best += scanDistance(typos[i % 64], names[j]) <= SUGGEST_MAX_DISTANCE;
+		}
+		gCallbackHits = gCallbackHits + best;
+	}));
+	std::sprintf(label, "dispatch misspelt n=%lu", (unsigned long)count);
+	report("suggest", label, measure(100000, [&](size_t i) { d.dispatch(typos[i % 64]); }));
+	std::sprintf(label, "dispatch known n=%lu", (unsigned long)count);
+	report("suggest", label, measure(200000, [&](size_t i) { d.dispatch(names[(i * 7919) % count]); }));
+}
+#endif
+
+static bool selected(int argc, char** argv, const char* stage) {
+	return argc < 2 || std::strcmp(argv[1], stage) == 0;
+}
+
+int main(int argc, char** argv) {
+	if (selected(argc, argv, "lexer"))
+		benchLexer();
+	if (selected(argc, argv, "value")) {
+		benchValues();
+		benchClassifier();
+	}
+	if (selected(argc, argv, "match") || selected(argc, argv, "dispatch")) {
+		const size_t sizes[] = { 10, 100, 1000, 10000 };
+		for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+			benchMatch(sizes[i], 0, 0);
+			benchMatch(sizes[i], 4, 0);
+			benchMatch(sizes[i], 4, 4);
+		}
+	}
+	if (selected(argc, argv, "merge") || selected(argc, argv, "dispatch"))
+		benchMerge();
+	if (selected(argc, argv, "register")) {
+		benchRegister(1000);
+		benchRegister(5000);
+	}
+	if (selected(argc, argv, "table"))
+		benchTable();
+	if (selected(argc, argv, "output"))
+		benchOutput();
+	if (selected(argc, argv, "layout"))
+		benchValueLayout();
+	if (selected(argc, argv, "batch")) {
+		benchBatch(1000);
+		benchBatch(10000);
+	}
+	if (selected(argc, argv, "pool")) {
+		benchPool(1);
+		benchPool(2);
+		benchPool(4);
+	}
+	if (selected(argc, argv, "wire"))
+		benchWire();
+	if (selected(argc, argv, "execute"))
+		benchExecute();
+	if (selected(argc, argv, "journal"))
+		benchJournal(1000000);
+	if (selected(argc, argv, "script"))
+		benchScript(50000);
+	if (selected(argc, argv, "errors"))
+		benchErrors();
+	if (selected(argc, argv, "complete"))
+		benchComplete();
+#ifdef USE_SUGGESTIONS
+	if (selected(argc, argv, "suggest")) {
+		benchSuggest(1000);
+		benchSuggest(10000);
+	}
+#endif
+
+	std::cout << "callbacks: " << gCallbackHits << std::endl;
+	return 0;
+}
@@ -2,22 +2,18 @@
 #include <vector>
 #include "RaptorCLI.h"
 
+// Argument slots of the "calc" command, in the order its ArgSpecs are added.
+enum { CALC_A_SLOT, CALC_B_SLOT, CALC_OP_SLOT };
+
 // Callback for the "calc" command.
 // Expects three arguments:
 //  -a : double (first operand)
 //  -b : double (second operand)
 //  -op: string (operator: +, -, *, /)
-void calcCallback(const Command & cmd) {
-	double a = 0.0, b = 0.0;
-	std::string op;
-	for (size_t i = 0; i < cmd.arguments.size(); i++) {
-		if (cmd.arguments[i].name == "a")
-			a = cmd.arguments[i].values[0].doubleValue;
-		else if (cmd.arguments[i].name == "b")
-			b = cmd.arguments[i].values[0].doubleValue;
-		else if (cmd.arguments[i].name == "op")
-			op = cmd.arguments[i].values[0].stringValue;
-	}
+void calcCallback(const Invocation & inv) {
+	double a = inv.getDouble(CALC_A_SLOT);
+	double b = inv.getDouble(CALC_B_SLOT);
+	std::string op = inv.getString(CALC_OP_SLOT);
 	std::cout << "[calc] " << a << " " << op << " " << b << " = ";
 	if (op == "+")
 		std::cout << (a + b);
@@ -87,7 +83,7 @@ int main() {
 	// Register "calc" command.
 	// Expects: -a (double), -b (double), -op (string)
 	Command calcCmd("calc", "Performs arithmetic operations");
-	calcCmd.callback = calcCallback;
+	calcCmd.invocationCallback = calcCallback;
 	calcCmd.addArgSpec(ArgSpec("a", VAL_DOUBLE, true, "First operand (double)"));
 	calcCmd.addArgSpec(ArgSpec("b", VAL_DOUBLE, true, "Second operand (double)"));
 	calcCmd.addArgSpec(ArgSpec("op", VAL_STRING, true, "Operator (+, -, *, /)"));
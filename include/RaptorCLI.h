@@ -3,6 +3,8 @@
 #define RAPTORCLI_H
 
 // #define USE_DESCRIPTIVE_ERRORS
+// Per-command statistics (see command_stats.h) are enabled with -DUSE_COMMAND_STATS for the whole build.
+// "Did you mean" suggestions (see suggestion_index.h) are enabled with -DUSE_SUGGESTIONS for the whole build.
 #define ERROR_CMD_UNKNOWN "error.cmd.unknown"
 #define ERROR_CMD_UNEXPECTED_TOKEN "error.cmd.unexpected_token"
 #define ERROR_CMD_DUPLICATE_HELP_FLAG "error.cmd.duplicate_help_flag"
@@ -11,12 +13,29 @@
 #define ERROR_CMD_DUPLICATE_NAME "error.cmd.duplicate_name"
 #define ERROR_CMD_DUPLICATE_ALIAS "error.cmd.duplicate_alias"
 #define ERROR_CMD_NO_CALLBACK "error.cmd.no_callback"
+#define ERROR_CMD_TOO_MANY_ARGS "error.cmd.too_many_args"
+#define ERROR_CMD_INPUT_TOO_LONG "error.cmd.input_too_long"
+#define ERROR_CMD_OUT_OF_MEMORY "error.cmd.out_of_memory"
+#define ERROR_CMD_FROZEN "error.cmd.frozen"
+#define ERROR_CMD_MALFORMED_FRAME "error.cmd.malformed_frame"
+#define ERROR_CMD_UNKNOWN_ARG "error.cmd.unknown_arg"
 
 #include "clioutput.h"
 #include "value.h"
 #include "argument.h"
+#include "command_stats.h"
+#include "cli_error.h"
+#include "invocation.h"
 #include "command.h"
+#include "command_table.h"
 #include "dispatcher.h"
+#include "dispatch_pool.h"
 #include "executable_command.h"
+#include "stream_parser.h"
+#include "wire_format.h"
+#include "command_journal.h"
+#include "script_runner.h"
+#include "suggestion_index.h"
+#include "completer.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,153 @@
+// include/arena.h
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#define ARENA_DEFAULT_BLOCK_SIZE 1024
+#define ARENA_ALIGNMENT sizeof(double)
+
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+#define RAPTORCLI_EXCEPTIONS 1
+#endif
+
+// Monotonic allocator for short-lived data. Allocation bumps a pointer, deallocation is a
+// no-op, and everything is released at once by reset().
+// A growable arena takes blocks from the heap as needed and, on reset, merges them into one
+// block large enough for the peak usage, so a steady workload stops touching the heap.
+// A fixed arena works inside a caller-provided buffer and never touches the heap. When it is
+// full, allocation fails rather than falling back to the heap, and the arena remembers that it
+// overflowed until the next reset, so callers several frames up can tell why their work failed.
+class Arena {
+public:
+	explicit Arena(size_t blockSize = ARENA_DEFAULT_BLOCK_SIZE);
+	Arena(void* buffer, size_t size);
+	~Arena();
+
+	// Return size bytes aligned to alignment, or a null pointer if a fixed arena is exhausted.
+	void* allocate(size_t size, size_t alignment = ARENA_ALIGNMENT);
+
+	// Whether allocate(size, alignment) would succeed. A failed check counts as an overflow.
+	bool canAllocate(size_t size, size_t alignment = ARENA_ALIGNMENT);
+
+	// Release everything allocated since the last reset.
+	void reset();
+
+	// Switch to a fixed, caller-provided buffer (or back to heap blocks if buffer is null).
+	void setBuffer(void* buffer, size_t size);
+
+	bool isFixed() const { return fixed; }
+	size_t getUsed() const { return used; }
+	size_t getPeak() const { return peak; }
+	size_t getCapacity() const;
+
+	// Whether an allocation has failed since the last reset or clearOverflow().
+	bool hasOverflowed() const { return overflowed; }
+	void clearOverflow() { overflowed = false; }
+
+private:
+	struct Block {
+		Block* next;
+		size_t size;
+		char* data() { return reinterpret_cast<char*>(this + 1); }
+	};
+
+	Block* blocks;      // Most recent block first
+	char* cursor;
+	char* limit;
+	size_t blockSize;
+	size_t used;        // Bytes handed out since the last reset
+	size_t peak;        // Highest `used` seen
+	bool fixed;
+	bool overflowed;    // An allocation failed since the last reset
+
+	Arena(const Arena&);
+	Arena& operator=(const Arena&);
+
+	void releaseBlocks();
+	bool addBlock(size_t minimum);
+	size_t padding(size_t alignment) const;
+};
+
+// Standard allocator adaptor over an Arena. A default-constructed allocator, or one with a
+// null arena, uses the heap, so arena-backed and heap-backed containers share one type.
+// Copies of a container always go to the heap; moves and swaps take the arena with them.
+// An exhausted fixed arena throws std::bad_alloc when exceptions are enabled and returns a null
+// pointer otherwise, so containers in a fixed arena must be grown through reserveRoom.
+template <class T>
+class ArenaAllocator {
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind { typedef ArenaAllocator<U> other; };
+
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	Arena* arena;
+
+	ArenaAllocator() : arena(0) {}
+	ArenaAllocator(Arena* a) : arena(a) {}
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+	static size_t alignment() { return alignof(T) > ARENA_ALIGNMENT ? alignof(T) : ARENA_ALIGNMENT; }
+
+	T* allocate(size_t n) {
+		if (!arena)
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		void* p = arena->allocate(n * sizeof(T), alignment());
+#ifdef RAPTORCLI_EXCEPTIONS
+		if (!p)
+			throw std::bad_alloc();
+#endif
+		return static_cast<T*>(p);
+	}
+
+	void deallocate(T* p, size_t) {
+		// Arena memory is released in bulk by Arena::reset.
+		if (!arena)
+			::operator delete(p);
+	}
+
+	ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+	template <class U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+	template <class U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+// Make room for `extra` more elements in v, so that adding them does not reach the allocator.
+// Returns false, leaving v unchanged, if v lives in a fixed arena without room for the larger
+// storage; vectors on the heap or in a growable arena always get their room.
+template <class T>
+bool reserveRoom(std::vector<T, ArenaAllocator<T> >& v, size_t extra = 1) {
+	size_t needed = v.size() + extra;
+	if (needed <= v.capacity())
+		return true;
+	size_t capacity = v.capacity() * 2 > needed ? v.capacity() * 2 : needed;
+	Arena* arena = v.get_allocator().arena;
+	if (arena && arena->isFixed()) {
+		// Settle for exactly the room asked for before giving up.
+		if (!arena->canAllocate(capacity * sizeof(T), ArenaAllocator<T>::alignment())) {
+			capacity = needed;
+			if (!arena->canAllocate(capacity * sizeof(T), ArenaAllocator<T>::alignment()))
+				return false;
+		}
+	}
+	v.reserve(capacity);
+	return true;
+}
+
+#endif
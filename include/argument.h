@@ -4,17 +4,69 @@
 
 #include <string>
 #include <vector>
+#include <cstring>
 #include "value.h"
+#include "arena.h"
 
+#define MAX_ARG_SPECS 64 // Limited by the bitmask used to detect duplicate flags
+
+// Value storage of an argument. During dispatch it is allocated from the dispatcher's arena;
+// copies made by callbacks are heap-allocated.
+typedef std::vector<Value, ArenaAllocator<Value> > ValueVector;
+
+// Name of an argument. It points at the name in the ArgSpec, or other text that outlives the
+// argument, instead of holding a copy, so binding an argument never allocates.
+// It converts to std::string so callbacks written against the old layout keep working.
+struct ArgumentName {
+	const char* text;
+	size_t length;
+
+	ArgumentName() : text(""), length(0) {}
+	ArgumentName(const char* s) : text(s), length(std::strlen(s)) {}
+	ArgumentName(const char* s, size_t n) : text(s), length(n) {}
+	// A string is only pointed at, so a temporary one is refused.
+	explicit ArgumentName(const std::string& s) : text(s.c_str()), length(s.size()) {}
+	ArgumentName(std::string&&) = delete;
+
+	const char* c_str() const { return text; }
+	const char* data() const { return text; }
+	size_t size() const { return length; }
+	bool empty() const { return length == 0; }
+	std::string str() const { return std::string(text, length); }
+	operator std::string() const { return str(); }
+
+	bool operator==(const char* s) const { return std::strlen(s) == length && std::memcmp(text, s, length) == 0; }
+	bool operator==(const std::string& s) const { return s.size() == length && std::memcmp(text, s.data(), length) == 0; }
+	bool operator!=(const char* s) const { return !(*this == s); }
+	bool operator!=(const std::string& s) const { return !(*this == s); }
+};
+
+inline std::string operator+(const std::string& lhs, const ArgumentName& rhs) { return lhs + rhs.str(); }
+inline std::string operator+(const char* lhs, const ArgumentName& rhs) { return lhs + rhs.str(); }
+inline std::string operator+(const ArgumentName& lhs, const std::string& rhs) { return lhs.str() + rhs; }
+inline std::string operator+(const ArgumentName& lhs, const char* rhs) { return lhs.str() + rhs; }
+
+template <class CharT, class Traits>
+std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const ArgumentName& name) {
+	return os.write(name.text, (std::streamsize)name.length);
+}
+
+// The name is not copied, so the text it is constructed from must outlive the argument; a
+// temporary std::string does not compile.
 class Argument {
 public:
-	std::string name;
-	std::vector<Value> values;
+	ArgumentName name;
+	ValueVector values;
 
 	Argument() {}
-	Argument(const std::string& n) : name(n) {}
+	Argument(const ArgumentName& n, Arena* arena = 0) : name(n), values(ArenaAllocator<Value>(arena)) {}
+	explicit Argument(const std::string& n, Arena* arena = 0) : name(n), values(ArenaAllocator<Value>(arena)) {}
+	Argument(std::string&&, Arena* arena = 0) = delete;
+	Argument(const char* n, Arena* arena = 0) : name(n), values(ArenaAllocator<Value>(arena)) {}
 };
 
+typedef std::vector<Argument, ArenaAllocator<Argument> > ArgumentList;
+
 struct ArgSpec {
 	std::string name;
 	ValueType type;
@@ -22,13 +74,14 @@ struct ArgSpec {
 	bool hasDefault;
 	Value defaultValue;
 	std::string helpText;
+	int slot; // Position in the owning command's argSpecs, assigned by Command::addArgSpec
 
 	ArgSpec(const std::string& n, ValueType t, bool req = false, const std::string& help = "")
-		: name(n), type(t), required(req), hasDefault(false), helpText(help) {
+		: name(n), type(t), required(req), hasDefault(false), helpText(help), slot(-1) {
 	}
 
 	ArgSpec(const std::string& n, ValueType t, bool req, const Value& def, const std::string& help)
-		: name(n), type(t), required(req), hasDefault(true), defaultValue(def), helpText(help) {
+		: name(n), type(t), required(req), hasDefault(true), defaultValue(def), helpText(help), slot(-1) {
 	}
 };
 
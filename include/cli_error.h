@@ -0,0 +1,96 @@
+// include/cli_error.h
+#ifndef CLI_ERROR_H
+#define CLI_ERROR_H
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+#include "lexer.h"
+#include "suggestion_index.h"
+
+class CLIOutput;
+class Command;
+struct ArgSpec;
+struct TableCommand;
+struct TableArgSpec;
+
+#define CLI_ERROR_NO_POSITION ((size_t)-1)
+#ifndef CLI_ERROR_TOKEN_MAX
+#define CLI_ERROR_TOKEN_MAX 64 // Longest quoted token rendered without its quotes; longer ones are shown as typed
+#endif
+
+// What went wrong. Several codes can share one ERROR_CMD_* string (see cliErrorCode) where
+// they only differ in how they are described.
+enum CLIErrorCode {
+	CLI_ERROR_NONE,
+	CLI_ERROR_UNKNOWN_COMMAND,      // The first token names no command
+	CLI_ERROR_UNKNOWN_COMMAND_ID,   // A binary frame names a command id the tree does not have
+	CLI_ERROR_UNEXPECTED_TOKEN,     // A token where a subcommand or flag was expected
+	CLI_ERROR_UNKNOWN_ARG,          // A flag that matches no ArgSpec of a non-variadic command (USE_SUGGESTIONS)
+	CLI_ERROR_DUPLICATE_ARG,        // A flag given twice
+	CLI_ERROR_DUPLICATE_HELP_FLAG,  // Both -h and -help
+	CLI_ERROR_MISSING_VALUE,        // A flag given without a value
+	CLI_ERROR_MISSING_REQUIRED_ARG, // A required argument not given
+	CLI_ERROR_TYPE_MISMATCH,        // A value that does not fit the declared type
+	CLI_ERROR_NO_CALLBACK,          // The command has no callback that can run
+	CLI_ERROR_OUT_OF_MEMORY,        // The command does not fit in the dispatch arena
+	CLI_ERROR_INPUT_TOO_LONG,       // A streamed command overflows the StreamParser buffer
+	CLI_ERROR_FRAME_VERSION,        // A binary frame with a missing or unsupported version
+	CLI_ERROR_MALFORMED_FRAME,      // A binary frame that cannot be decoded
+	CLI_ERROR_FROZEN,               // A command registered after freeze()
+	CLI_ERROR_DUPLICATE_NAME,       // A command registered under a name already taken
+	CLI_ERROR_DUPLICATE_ALIAS,      // A command registered with an alias already taken
+	CLI_ERROR_DUPLICATE_SUBCOMMAND, // A subcommand added under a name already taken by a sibling
+	CLI_ERROR_DUPLICATE_SUBCOMMAND_ALIAS, // A subcommand added with a name or alias already taken by a sibling
+	CLI_ERROR_ALIAS_IS_NAME,        // An alias equal to the command's own name
+	CLI_ERROR_REPEATED_ALIAS,       // An alias the command already has
+	CLI_ERROR_DUPLICATE_ARG_NAME,   // An ArgSpec added under a name the command already has
+	CLI_ERROR_TOO_MANY_ARGS,        // An ArgSpec beyond MAX_ARG_SPECS, or a table entry with more
+	CLI_ERROR_COUNT
+};
+
+// Return the ERROR_CMD_* code of a CLIErrorCode, or an empty string for CLI_ERROR_NONE.
+const char* cliErrorCode(CLIErrorCode code);
+
+// An error as the dispatcher found it. It only refers to the input and the command tree, so
+// building and delivering one never allocates; the text is rendered only when asked for.
+// The pointers are valid while the error is being reported, that is, for the duration of the
+// error handler.
+struct CLIError {
+	CLIErrorCode code;
+	size_t tokenIndex;                // Offending token within the command's tokens, or CLI_ERROR_NO_POSITION
+	size_t offset;                    // Byte offset of that token in the dispatched input, or of the
+	                                  // fault in a binary frame or stream buffer; CLI_ERROR_NO_POSITION if none
+	Token token;                      // The offending token as typed; null data if there is none
+	const Command* command;           // Command being run or registered, or null
+	const TableCommand* tableCommand; // Command table entry being run, or null
+	const ArgSpec* argSpec;           // Spec of the offending argument, or null
+	const TableArgSpec* tableArgSpec; // Same for a command table entry
+	const char* name;                 // Name or alias that clashed on registration, or null
+	uint32_t commandId;               // Id a binary frame named, for CLI_ERROR_UNKNOWN_COMMAND_ID
+	const Suggestions* suggestions;   // Closest names to the token (USE_SUGGESTIONS), or null
+
+	explicit CLIError(CLIErrorCode errorCode = CLI_ERROR_NONE);
+
+	// Point the error at tokens[index]; offsets count from input, or from the first token if input is null.
+	void setToken(const TokenList& tokens, size_t index, const char* input);
+
+	// The ERROR_CMD_* code.
+	const char* codeString() const { return cliErrorCode(code); }
+
+	// Name of the command or argument the error refers to, or an empty string.
+	const char* commandName() const;
+	const char* argumentName() const;
+
+	// Write the descriptive text, e.g. "Unknown command: netwrok. Did you mean: network?", to
+	// buffer and null-terminate it, cutting it short if it does not fit. Returns the length written.
+	size_t render(char* buffer, size_t size) const;
+
+	// Write the descriptive text to out, without a line end.
+	void print(CLIOutput* out) const;
+
+	// The descriptive text as a string; allocates, unlike the two above.
+	std::string text() const;
+};
+
+#endif
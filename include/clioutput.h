@@ -2,6 +2,7 @@
 #ifndef CLI_OUTPUT_H
 #define CLI_OUTPUT_H
 
+#include <cstddef>
 #ifdef ARDUINO
 #include <Arduino.h>
 #else
@@ -9,28 +10,82 @@
 #include <string>
 #endif
 
+#define CLI_OUTPUT_BUFFER_SIZE 1024
+
 class CLIOutput {
 public:
 	virtual void print(const std::string& s) = 0;
 	virtual void println(const std::string& s) = 0;
 	virtual void println() = 0;
+
+	// Print raw bytes without building a std::string. The default goes through print().
+	virtual void write(const char* data, size_t length) { print(std::string(data, length)); }
+
+	// Push out anything held back. The dispatcher calls this when a top-level dispatch returns.
+	virtual void flush() {}
+
 	virtual ~CLIOutput() = default;
 };
 
 #ifdef ARDUINO
+// flush() is left as a no-op: Serial already sends from its own buffer in the background, and
+// Serial.flush() would block every dispatch until the last byte is on the wire.
 class ArduinoCLIOutput : public CLIOutput {
 public:
 	void print(const std::string& s) override { Serial.print(s.c_str()); }
 	void println(const std::string& s) override { Serial.println(s.c_str()); }
 	void println() override { Serial.println(); }
+	void write(const char* data, size_t length) override { Serial.write(reinterpret_cast<const uint8_t*>(data), length); }
 };
 #else
+// Lines end with '\n' rather than std::endl, so std::cout is flushed once per dispatch instead of once per line.
 class StdCLIOutput : public CLIOutput {
 public:
 	void print(const std::string& s) override { std::cout << s; }
-	void println(const std::string& s) override { std::cout << s << std::endl; }
-	void println() override { std::cout << std::endl; }
+	void println(const std::string& s) override { std::cout << s << '\n'; }
+	void println() override { std::cout << '\n'; }
+	void write(const char* data, size_t length) override { std::cout.write(data, (std::streamsize)length); }
+	void flush() override { std::cout.flush(); }
 };
 #endif
 
-#endif
\ No newline at end of file
+// Collects output in a fixed buffer and passes it on in large writes: when the buffer fills, and
+// on flush(). Text that does not fit is written together with the buffered part in one call
+// (writev on POSIX), so it is never split into extra writes. The default destination is
+// standard output (Serial on Arduino); override sink() to send it elsewhere.
+class BufferedCLIOutput : public CLIOutput {
+public:
+	// Allocate a buffer of the given size once.
+	explicit BufferedCLIOutput(size_t capacity = CLI_OUTPUT_BUFFER_SIZE);
+
+	// Use a caller-provided buffer instead; it must outlive the output.
+	BufferedCLIOutput(char* buffer, size_t capacity);
+
+	// Flushes what is left. Subclasses that override sink() must call flush() in their own destructor.
+	~BufferedCLIOutput() override;
+
+	void print(const std::string& s) override { write(s.data(), s.size()); }
+	void println(const std::string& s) override;
+	void println() override { write("\n", 1); }
+	void write(const char* data, size_t length) override;
+	void flush() override;
+
+	size_t getBuffered() const { return used; }
+	size_t getCapacity() const { return capacity; }
+
+protected:
+	// Write first and then second to the destination, as one operation where the platform allows.
+	// Either part may be empty.
+	virtual void sink(const char* first, size_t firstLength, const char* second, size_t secondLength);
+
+private:
+	char* buffer;
+	size_t capacity;
+	size_t used;
+	bool ownsBuffer;
+
+	BufferedCLIOutput(const BufferedCLIOutput&);
+	BufferedCLIOutput& operator=(const BufferedCLIOutput&);
+};
+
+#endif
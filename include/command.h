@@ -7,9 +7,17 @@
 #include "argument.h"
 #include <cstddef>
 #include "clioutput.h"
+#include "command_index.h"
+#include "invocation.h"
+#include "command_stats.h"
+#include "help_writer.h"
+#include "wire_format.h"
 
 class Command;
+struct CLIError;
 typedef void (*CommandCallback)(const Command&);
+typedef void (*CommandErrorCallback)(const std::string& msg);
+typedef void (*CommandErrorHandler)(const CLIError& error);
 
 class Command {
 public:
@@ -17,36 +25,100 @@ public:
 	std::string description;
 	std::vector<std::string> aliases; // Additional names for the command
 	std::vector<Command> subcommands; // Optional child commands
-	std::vector<Argument> arguments;  // Parsed arguments after dispatch
+	mutable ArgumentList arguments;   // Parsed arguments, bound only while a CommandCallback runs
 	std::vector<ArgSpec> argSpecs;    // Declared expected arguments
 
 	bool variadic;
 
-	CommandCallback callback;
+	uint32_t id; // Position in the frozen tree, assigned by Dispatcher::freeze(); WIRE_NO_ID until then
+
+	CommandCallback callback;             // Legacy callback, receives the command with `arguments` bound
+	InvocationCallback invocationCallback; // Preferred callback, receives the arguments without touching the command
+
+#ifdef USE_COMMAND_STATS
+	mutable CommandStats stats; // Updated by the dispatcher on every dispatch of this command
+#endif
 
 	Command();
 	Command(const std::string& cmdName, const std::string& desc = "", CLIOutput* output = nullptr, CommandCallback cb = nullptr);
 
-	// Set the command to accept arbitrary extra arguments.
+	// Set the command to accept arbitrary extra arguments. Otherwise, with USE_SUGGESTIONS, a flag
+	// without a spec fails with ERROR_CMD_UNKNOWN_ARG; without it such flags are ignored.
 	void setVariadic(bool v) { variadic = v; }
 
 	// Add a subcommand (returns true if added successfully, false on error).
+	// The rvalue overload moves cmd and its subtree into place instead of copying them.
 	bool addSubcommand(const Command& cmd);
+	bool addSubcommand(Command&& cmd);
+
+	// Find a direct subcommand by name or alias; returns a null pointer if there is none.
+	const Command* findSubcommand(const char* token, size_t length) const;
+
+#ifdef USE_SUGGESTIONS
+	// Fill out with the subcommand names and aliases, or the argument names, closest to token.
+	void suggestSubcommands(const char* token, size_t length, Suggestions& out) const;
+	void suggestArguments(const char* token, size_t length, Suggestions& out) const;
+#endif
 
 	// Add an alias (returns true if added successfully, false on error).
 	bool addAlias(const std::string& alias);
 
 	// Add an expected argument specification (returns true if added successfully, false on error).
+	// The spec's slot is its position in argSpecs, so slots follow declaration order.
 	bool addArgSpec(const ArgSpec& spec);
 
+	// Return the slot of the named argument spec, or -1 if there is none.
+	int argSlot(const std::string& name) const;
+	int argSlot(const char* token, size_t length) const;
+
+	// Call the command's callback with the given arguments. Legacy callbacks see them through
+	// `arguments`, which is swapped in for the duration of the call. `slotPositions` optionally maps
+	// each argument slot to its position in args (-1 if absent). `dispatcher` is passed on to the Invocation.
+	// Returns false if there is no callback.
+	bool invoke(ArgumentList& args, CLIOutput* out, const int* slotPositions = nullptr,
+		Dispatcher* dispatcher = nullptr) const;
+
 	// Print usage information for this command and recursively for its subcommands.
+	// Every line starts with prefix, and subcommand lines are indented further after it.
 	void printUsage(const std::string& prefix = "", CLIOutput* output = nullptr) const;
 
+	// Stream the usage of this command and its subtree through writer, indented by indent spaces.
+	// Each command's own lines are rendered on first use and cached until the command changes.
+	void writeUsage(HelpWriter& writer, size_t indent = 0) const;
+
+	// Render the cached usage of this command and its subtree now, so that printing it later does
+	// not modify the command, e.g. before the tree is shared between threads.
+	void renderUsage() const;
+
+	// Drop the cached usage. add* methods do this themselves; call it after changing the name,
+	// description, aliases, argSpecs or subcommands directly.
+	void invalidateUsage() { usageRendered = false; }
+
 	void registerOutput(CLIOutput* out);
 
+	// Release the spare capacity of this command and its subtree, including the indexes.
+	void shrinkToFit();
+
+	// Errors of addSubcommand, addAlias and addArgSpec are reported here. They happen while a
+	// tree is built, before any dispatcher owns it, so they do not go through a Dispatcher.
+	// The callback gets the ERROR_CMD_* code, or the text with USE_DESCRIPTIVE_ERRORS; a handler
+	// gets the CLIError and takes precedence. Without either they are only signalled by the
+	// return value.
+	static void registerErrorCallback(CommandErrorCallback callback);
+	static void registerErrorHandler(CommandErrorHandler handler);
+
 	CLIOutput* getOutput() const;
 private:
 	CLIOutput* output;
+	CommandIndex subcommandIndex; // Name and alias index over subcommands
+	CommandIndex argIndex;        // Name index over argSpecs
+	mutable std::string usageText; // This command's own usage lines, without its subcommands
+	mutable bool usageRendered;
+
+	// Report and return false if cmd's name or an alias is already taken by a subcommand.
+	bool canAddSubcommand(const Command& cmd) const;
+
+	static void reportError(const CLIError& error);
 };
 
 #endif
@@ -0,0 +1,73 @@
+// include/command_index.h
+#ifndef COMMAND_INDEX_H
+#define COMMAND_INDEX_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include "suggestion_index.h"
+
+class Command;
+struct ArgSpec;
+
+// Open-addressing hash index over the names and aliases of a list of sibling commands,
+// or over the names of a command's argument specs.
+// The index does not own any strings, it only stores hashes and positions into the
+// vector it was built for, so it stays valid when that vector is copied.
+class CommandIndex {
+public:
+	CommandIndex();
+
+	// Index the name and all aliases of commands[position].
+	void insert(const std::vector<Command>& commands, size_t position);
+
+	// Return the position of the command whose name or alias equals the given token, or -1.
+	int find(const std::vector<Command>& commands, const char* token, size_t length) const;
+	int find(const std::vector<Command>& commands, const std::string& token) const;
+
+	// Return the first of cmd's name and aliases that is already a name or alias of one of
+	// the indexed commands, or a null pointer if cmd can be added without a clash.
+	const std::string* findClash(const std::vector<Command>& commands, const Command& cmd) const;
+
+	// Index the name of specs[position].
+	void insert(const std::vector<ArgSpec>& specs, size_t position);
+
+	// Return the position of the spec with the given name, or -1.
+	int find(const std::vector<ArgSpec>& specs, const char* token, size_t length) const;
+
+#ifdef USE_SUGGESTIONS
+	// Fill out with the indexed names and aliases closest to token (see suggestion_index.h).
+	void suggest(const char* token, size_t length, Suggestions& out) const { suggestions.suggest(token, length, out); }
+#endif
+
+	void clear();
+
+	// Rebuild the table at the smallest size that keeps the load factor at or below one half.
+	void shrinkToFit();
+
+	// FNV-1a hash used for all name lookups.
+	static uint32_t hash(const char* s, size_t length);
+
+private:
+	struct Slot {
+		uint32_t hash;
+		uint32_t command; // Position in the indexed vector, EMPTY_SLOT if unused
+		int32_t alias;    // Alias position, or -1 for the command name
+	};
+
+	std::vector<Slot> slots;
+	size_t used;
+#ifdef USE_SUGGESTIONS
+	SuggestionIndex suggestions; // Only consulted when a lookup has failed
+#endif
+
+	void insertKey(uint32_t keyHash, uint32_t command, int32_t alias);
+	void grow();
+	void rebuild(size_t size);
+
+	template <class T>
+	int findIn(const std::vector<T>& items, const char* token, size_t length) const;
+};
+
+#endif
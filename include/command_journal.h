@@ -0,0 +1,104 @@
+// include/command_journal.h
+#ifndef COMMAND_JOURNAL_H
+#define COMMAND_JOURNAL_H
+
+#include <stdint.h>
+#include <cstddef>
+#include "argument.h"
+#include "wire_format.h"
+
+// Files can be mapped into memory on hosted POSIX platforms; elsewhere a journal lives in a caller buffer.
+#if !defined(ARDUINO) && (defined(__unix__) || defined(__APPLE__))
+#define RAPTORCLI_MMAP 1
+#endif
+
+#define JOURNAL_MAGIC "RCJ"
+#define JOURNAL_VERSION 1
+#define JOURNAL_HEADER_SIZE 4
+#define JOURNAL_CHECKSUM_SIZE 2
+#define JOURNAL_DEFAULT_GROUP_SIZE 512 // Records per commit
+
+class Command;
+
+// Append-only log of dispatched commands. A record is one command in the binary wire format
+// (see wire_format.h), its id in the frozen tree and its bound arguments, so replaying it takes
+// no lexing or name lookup:
+//
+//	journal := "RCJ" JOURNAL_VERSION record* 0
+//	record  := varint(length) command checksum
+//
+// The checksum is the low 16 bits of the FNV-1a hash of the command, little-endian.
+// The storage is allocated up front and zero-filled, either a caller buffer or a file mapped
+// into memory, so appending is a copy and the first zero length marks the end; every append
+// also writes that zero after its record. After a crash, opening the journal again finds the
+// end by scanning up to the first record that is cut off or fails its checksum, and zeroes
+// whatever follows it.
+//
+// Records are committed in groups: the mapped pages are written back to the file every
+// `groupSize` records and on commit(), not on every append. A journal is not thread-safe;
+// give each dispatcher of a DispatchPool its own.
+class CommandJournal {
+public:
+	CommandJournal();
+	~CommandJournal();
+
+	// Journal into a caller buffer, which must outlive the journal. Records already in it are
+	// kept if it starts with a journal header, e.g. in RAM retained across a reset; otherwise
+	// it is cleared.
+	void setBuffer(uint8_t* buffer, size_t size);
+
+#ifdef RAPTORCLI_MMAP
+	// Open or create a journal file of at least `capacity` bytes and map it into memory. New
+	// records are appended after those already in the file. Returns false if the file cannot
+	// be created or mapped, or holds something other than a journal.
+	bool open(const char* path, size_t capacity);
+#endif
+
+	// Commit and release the storage.
+	void close();
+
+	// Commit after every `records` appends; 1 commits each record as it is appended.
+	void setGroupSize(size_t records) { groupSize = records ? records : 1; }
+
+	// Write the records appended since the last commit back to the file. Returns false if that fails.
+	bool commit();
+
+	// Append a record of cmd called with args; slotPositions maps each of cmd's slots to its
+	// position in args (-1 if absent). Returns false, and counts the record as dropped, if the
+	// journal is full or closed or cmd is not part of a frozen tree.
+	bool append(const Command& cmd, const ArgumentList& args, const int* slotPositions);
+
+	// Remove every record.
+	void clear();
+
+	// Read the record at offset, starting from begin(), and advance offset past it.
+	// Returns false at the end of the journal.
+	bool next(size_t& offset, const uint8_t*& record, size_t& length) const;
+	size_t begin() const { return JOURNAL_HEADER_SIZE; }
+
+	bool isOpen() const { return data != 0; }
+	size_t getRecords() const { return records; }
+	size_t getDropped() const { return dropped; }
+	size_t getUsed() const { return used; }
+	size_t getCapacity() const { return capacity; }
+
+private:
+	uint8_t* data;
+	size_t capacity;
+	size_t used;      // End of the last record
+	size_t committed; // End of the last committed record
+	size_t records;
+	size_t dropped;
+	size_t groupSize;
+	size_t pending;   // Records appended since the last commit
+	bool mapped;      // data is a file mapping rather than a caller buffer
+
+	CommandJournal(const CommandJournal&);
+	CommandJournal& operator=(const CommandJournal&);
+
+	// Keep the records in data if it holds a journal, zeroing anything after the last good record,
+	// or start an empty one if it is all zeros. Returns false if it holds anything else.
+	bool attach();
+};
+
+#endif
@@ -0,0 +1,62 @@
+// include/command_stats.h
+#ifndef COMMAND_STATS_H
+#define COMMAND_STATS_H
+
+#include <stdint.h>
+#include <cstddef>
+
+// Runtime statistics are only collected when USE_COMMAND_STATS is defined. It adds members to
+// Command and Dispatcher, so it must be defined for the whole build (-DUSE_COMMAND_STATS or a
+// build flag), not in a single source file. Without it, nothing here is referenced on the hot path.
+
+#ifndef STATS_HISTOGRAM_BUCKETS
+#define STATS_HISTOGRAM_BUCKETS 24 // Bucket 23 collects everything from about 8 ms up
+#endif
+
+// Dispatch errors counted by the statistics, one per ERROR_CMD_* code that dispatch can report.
+enum StatsError {
+	STATS_ERROR_UNKNOWN_COMMAND,
+	STATS_ERROR_UNEXPECTED_TOKEN,
+	STATS_ERROR_DUPLICATE_HELP_FLAG,
+	STATS_ERROR_DUPLICATE_NAME,
+	STATS_ERROR_MISSING_REQUIRED_ARG,
+	STATS_ERROR_TYPE_MISMATCH,
+	STATS_ERROR_NO_CALLBACK,
+	STATS_ERROR_OUT_OF_MEMORY,
+	STATS_ERROR_INPUT_TOO_LONG,
+	STATS_ERROR_MALFORMED_FRAME,
+	STATS_ERROR_UNKNOWN_ARG,
+	STATS_ERROR_COUNT
+};
+
+// Return the ERROR_CMD_* code of a StatsError.
+const char* statsErrorCode(StatsError error);
+
+// Monotonic time in nanoseconds, wrapping at 32 bits; only differences are meaningful.
+uint32_t statsClock();
+
+// Fixed-bucket log2 histogram of latencies in nanoseconds. Bucket i counts samples in
+// [2^i, 2^(i+1)) ns, and the last bucket also holds everything larger. Recording never allocates.
+struct LatencyHistogram {
+	uint32_t buckets[STATS_HISTOGRAM_BUCKETS];
+	uint32_t count;
+
+	void reset();
+	void record(uint32_t nanoseconds);
+
+	// Upper bound in nanoseconds of the bucket holding the given percentile (0-100), or 0 if empty.
+	uint32_t percentile(unsigned percent) const;
+};
+
+struct CommandStats {
+	uint32_t dispatches;                // Dispatches that reached this command, including failed ones
+	uint32_t errors[STATS_ERROR_COUNT]; // Failed dispatches by error
+	LatencyHistogram parse;             // Matching, argument parsing and binding of successful dispatches
+	LatencyHistogram callback;          // Callback run time
+
+	CommandStats() { reset(); }
+	void reset();
+	uint32_t errorCount() const;
+};
+
+#endif
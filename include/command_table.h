@@ -0,0 +1,127 @@
+// include/command_table.h
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include <string>
+#include <stdint.h>
+#include <cstddef>
+#include "value.h"
+#include "argument.h"
+#include "invocation.h"
+#include "clioutput.h"
+#include "help_writer.h"
+
+// Command tables declare a command tree as constant data instead of building Command objects
+// at startup. Every field is a constant expression, so a namespace-scope `static const` table is
+// initialised by the compiler, lands in read-only memory (flash on ESP32 and other targets that
+// map flash into the address space) and costs no heap or startup time. AVR keeps const data in
+// RAM unless it is marked PROGMEM, which tables do not support.
+//
+//	static const TableArgSpec LED_ARGS[] = {
+//		TABLE_ARG("on", VAL_BOOL, true, TABLE_NO_DEFAULT, "Turn the LED on or off"),
+//		TABLE_ARG("pin", VAL_INT, false, TABLE_INT(13), "GPIO pin"),
+//	};
+//	static const TableName LED_ALIASES[] = { TABLE_NAME("l") };
+//	static const TableCommand COMMANDS[] = {
+//		TABLE_COMMAND("led", "Switch the LED", ledCallback, TABLE_LIST(LED_ALIASES), TABLE_ARGS(LED_ARGS), TABLE_NONE),
+//	};
+//	dispatcher.registerTable(COMMANDS);
+//
+// Argument slots follow the order of the TableArgSpec array, as with Command::addArgSpec.
+
+#define TABLE_FNV_OFFSET_BASIS 2166136261u
+#define TABLE_FNV_PRIME 16777619u
+
+// FNV-1a hash of a terminated string, the same hash CommandIndex uses, usable in constant expressions.
+constexpr uint32_t tableHash(const char* s, uint32_t h = TABLE_FNV_OFFSET_BASIS) {
+	return *s ? tableHash(s + 1, (uint32_t)((h ^ (unsigned char)*s) * TABLE_FNV_PRIME)) : h;
+}
+
+// A command or argument name with its precomputed hash.
+struct TableName {
+	const char* text;
+	uint32_t hash;
+
+	bool matches(const char* token, size_t length, uint32_t tokenHash) const;
+};
+
+// Default value of a table argument; `type` is VAL_NONE when there is none.
+struct TableValue {
+	ValueType type;
+	int intValue; // Also holds bools
+	double doubleValue;
+	const char* stringValue;
+};
+
+struct TableArgSpec {
+	TableName name;
+	ValueType type;
+	bool required;
+	TableValue defaultValue;
+	const char* helpText;
+
+	bool hasDefault() const { return defaultValue.type != VAL_NONE; }
+
+	// The default as a Value; strings point into the table instead of being copied.
+	Value defaultAsValue() const;
+};
+
+struct TableCommand {
+	TableName name;
+	const char* description;
+	InvocationCallback callback;
+	const TableName* aliases;
+	uint16_t aliasCount;
+	const TableArgSpec* argSpecs;
+	uint16_t argCount;
+	const TableCommand* subcommands;
+	uint16_t subcommandCount;
+	bool variadic; // Accepts flags without a spec, as Command::setVariadic
+
+	// Find a command by name or alias among count entries; returns a null pointer if there is none.
+	static const TableCommand* find(const TableCommand* commands, size_t count, const char* token, size_t length);
+
+	// Find a direct subcommand by name or alias; returns a null pointer if there is none.
+	const TableCommand* findSubcommand(const char* token, size_t length) const {
+		return find(subcommands, subcommandCount, token, length);
+	}
+
+	// Return the slot of the named argument spec, or -1 if there is none.
+	int argSlot(const char* token, size_t length) const;
+
+	// Print usage information for this command and recursively for its subcommands,
+	// in the same format as Command::printUsage.
+	void printUsage(const std::string& prefix = "", CLIOutput* output = nullptr) const;
+
+	// Stream the usage of this command and its subtree through writer, indented by indent spaces.
+	void writeUsage(HelpWriter& writer, size_t indent = 0) const;
+};
+
+#define TABLE_NAME(text) { text, tableHash(text) }
+#define TABLE_LIST(array) array, (uint16_t)(sizeof(array) / sizeof((array)[0]))
+
+// Same as TABLE_LIST for argument specs, but fails to compile when there are more than
+// MAX_ARG_SPECS of them. Dispatcher::registerTable refuses such a table at runtime otherwise.
+template <size_t N>
+constexpr uint16_t tableArgCount() {
+	static_assert(N <= MAX_ARG_SPECS, "A table command has more than MAX_ARG_SPECS arguments");
+	return (uint16_t)N;
+}
+#define TABLE_ARGS(array) array, tableArgCount<sizeof(array) / sizeof((array)[0])>()
+#define TABLE_NONE nullptr, 0
+
+#define TABLE_NO_DEFAULT { VAL_NONE, 0, 0.0, nullptr }
+#define TABLE_INT(v) { VAL_INT, (v), 0.0, nullptr }
+#define TABLE_DOUBLE(v) { VAL_DOUBLE, 0, (v), nullptr }
+#define TABLE_BOOL(v) { VAL_BOOL, (v) ? 1 : 0, 0.0, nullptr }
+#define TABLE_STRING(v) { VAL_STRING, 0, 0.0, (v) }
+
+#define TABLE_ARG(name, type, required, defaultValue, help) { TABLE_NAME(name), type, required, defaultValue, help }
+
+// aliases and subcommands are each TABLE_LIST(array) or TABLE_NONE, args TABLE_ARGS(array) or TABLE_NONE.
+#define TABLE_COMMAND(name, description, callback, aliases, args, subcommands) \
+	{ TABLE_NAME(name), description, callback, aliases, args, subcommands, false }
+#define TABLE_VARIADIC_COMMAND(name, description, callback, aliases, args, subcommands) \
+	{ TABLE_NAME(name), description, callback, aliases, args, subcommands, true }
+
+#endif
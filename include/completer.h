@@ -0,0 +1,101 @@
+// include/completer.h
+#ifndef COMPLETER_H
+#define COMPLETER_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+#include "dispatcher.h"
+#include "lexer.h"
+
+enum CompletionKind {
+	COMPLETION_COMMAND, // A command or subcommand name
+	COMPLETION_ALIAS,   // An alias of a command or subcommand
+	COMPLETION_FLAG,    // The name of an argument spec, completed with its leading '-'
+	COMPLETION_VALUE    // A value of the flag before the cursor, e.g. true or false
+};
+
+// A word the input at the cursor can be completed to.
+struct Completion {
+	const char* text; // Name without the leading '-' of a flag; points into the command tree
+	size_t length;
+	CompletionKind kind;
+
+	// Length of the word as typed, including the '-' of a flag.
+	size_t wordLength() const { return length + (kind == COMPLETION_FLAG ? 1 : 0); }
+};
+
+// Tab completion over the command tree of a dispatcher, for interactive consoles.
+// complete() takes the line being edited and the cursor and lists what the word ending at the
+// cursor can become: commands, subcommands and aliases while the command path is typed, then
+// `-flag` names of the matched command's ArgSpecs that have not been given yet, and true or
+// false after a bool flag. Text after the cursor is ignored, as are quoted words and lists.
+//
+// Keep one Completer per console session. It remembers the line it last completed and the
+// state of the command path after every word, so when the next call shares a prefix with it,
+// as on each keystroke, only the changed part of the line is lexed again. Once its buffers have
+// grown to the longest line, completing allocates nothing.
+// The dispatcher must outlive the completer, and its tree must not change while a session
+// holds state from it; call reset() after registering more commands.
+class Completer {
+public:
+	explicit Completer(const Dispatcher& dispatcher);
+
+	// Complete the word ending at cursor in line[0, length). Returns the number of candidates.
+	size_t complete(const char* line, size_t length, size_t cursor);
+	size_t complete(const std::string& line, size_t cursor) { return complete(line.data(), line.size(), cursor); }
+
+	// Results of the last complete(): the candidates, commands in registration order, and the
+	// start of the word they replace, which ends at the cursor.
+	const std::vector<Completion>& getCompletions() const { return completions; }
+	size_t getWordStart() const { return wordStart; }
+
+	// Length of the text every candidate starts with, counted from the word start, so that a
+	// console can insert completion.substr(cursor - wordStart, commonLength) on tab.
+	size_t commonLength() const;
+
+	// Write the candidates on one line, separated by spaces: a short response in place of help.
+	void print(CLIOutput* out = nullptr) const;
+
+	// Forget the remembered line.
+	void reset();
+
+private:
+	// What the words of the current command before some point of the line have matched.
+	struct Path {
+		const Command* command;    // Registered command matched so far, or null
+		const TableCommand* entry; // Command table entry matched so far, or null
+		bool failed;               // The words match no command, so nothing can be completed
+		bool inArguments;          // A flag has been given, so no more subcommands follow
+		int flag;                  // Slot of the last flag given, or -1
+		size_t flagValues;         // Values given after that flag
+		uint64_t seenSlots;        // Flags given so far, by slot
+	};
+
+	// The path after the words before offset, which is the start of a word or a command.
+	struct Checkpoint {
+		size_t offset;
+		Path path;
+	};
+
+	const Dispatcher& dispatcher;
+	std::string line;                     // The line up to the cursor of the last call
+	std::vector<Checkpoint> checkpoints;  // One per word of the line, in order
+	std::vector<Completion> completions;
+	size_t wordStart;
+
+	static Path emptyPath();
+
+	// Advance path over the word line[begin, end).
+	void addWord(Path& path, size_t begin, size_t end, bool quoted) const;
+
+	// Fill completions for the word line[begin, end) after path.
+	void collect(const Path& path, size_t begin, size_t end);
+	void collectCommands(const char* prefix, size_t length);
+	void collectSubcommands(const Path& path, const char* prefix, size_t length);
+	void collectFlags(const Path& path, const char* prefix, size_t length);
+	void add(const char* text, size_t length, CompletionKind kind, const char* prefix, size_t prefixLength);
+};
+
+#endif
@@ -0,0 +1,108 @@
+// include/dispatch_pool.h
+#ifndef DISPATCH_POOL_H
+#define DISPATCH_POOL_H
+
+// Threads are available on hosted platforms and on the ESP32; other Arduino boards have none.
+#if !defined(ARDUINO) || defined(ESP32)
+#define RAPTORCLI_THREADS 1
+#endif
+
+#ifdef RAPTORCLI_THREADS
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include <stdint.h>
+#include "dispatcher.h"
+
+#define POOL_UNORDERED 0 // Connection id of commands that need no ordering
+
+// Runs commands on a set of worker threads. Every worker has its own Dispatcher sharing the
+// command tree of the source dispatcher (see Dispatcher(const Dispatcher*)), so parsing and
+// matching need no locks. Each worker has its own queue; an idle worker steals from the others.
+//
+// Commands submitted with the same connection id run one at a time in submission order, for
+// example the commands of one radio link; commands of different connections, and commands
+// submitted with POOL_UNORDERED, run in parallel.
+class DispatchPool {
+public:
+	// Freeze source and start `workers` threads, one per hardware thread if 0.
+	// source must outlive the pool. Its output and error callback are called from the workers.
+	explicit DispatchPool(Dispatcher& source, size_t workers = 0);
+
+	// Run everything already submitted, then stop the workers.
+	~DispatchPool();
+
+	// Queue a command line; the input is copied. May be called from any thread.
+	void submit(const std::string& input, uint32_t connection = POOL_UNORDERED);
+	void submit(const char* input, size_t length, uint32_t connection);
+
+	// Block until every command submitted so far has finished.
+	void wait();
+
+	size_t getWorkerCount() const { return workers.size(); }
+
+	// Commands finished since the pool started, and how many of them failed.
+	uint64_t getCompleted() const { return completed.load(); }
+	uint64_t getFailed() const { return failed.load(); }
+
+	// The dispatcher of a worker, e.g. to read its statistics totals once the pool is idle.
+	const Dispatcher& getWorkerDispatcher(size_t worker) const { return *workers[worker]->dispatcher; }
+
+private:
+	// A queued unit of work: an unordered command, or a turn of a connection that has commands waiting.
+	struct Job {
+		std::string input;
+		uint32_t connection;
+	};
+
+	struct Worker {
+		Dispatcher* dispatcher;
+		std::deque<Job> jobs;
+		std::mutex mutex;
+		std::thread thread;
+	};
+
+	// Commands of one connection waiting for their turn. While `scheduled`, exactly one job for the
+	// connection is queued or running, which keeps its commands in order.
+	struct Connection {
+		std::deque<std::string> pending;
+		bool scheduled;
+
+		Connection() : scheduled(false) {}
+	};
+
+	std::vector<Worker*> workers;
+	std::atomic<size_t> nextWorker;
+
+	std::mutex connectionsMutex;
+	std::unordered_map<uint32_t, Connection> connections;
+
+	std::mutex stateMutex;
+	std::condition_variable workAvailable;
+	std::condition_variable idle;
+	size_t queuedJobs;   // Jobs in all worker queues, guarded by stateMutex and counted as they are queued
+	size_t outstanding;  // Submitted commands not yet finished, guarded by stateMutex
+	bool stopping;
+
+	std::atomic<uint64_t> completed;
+	std::atomic<uint64_t> failed;
+
+	DispatchPool(const DispatchPool&);
+	DispatchPool& operator=(const DispatchPool&);
+
+	void push(size_t worker, Job&& job);
+	bool pop(size_t worker, Job& job);
+	void run(size_t worker);
+	void execute(size_t worker, Job& job);
+	void finish(bool success);
+};
+
+#endif
+
+#endif
@@ -4,59 +4,398 @@
 
 #include <string>
 #include <vector>
+#include <functional>
+#include <deque>
 #include "command.h"
+#include "command_index.h"
+#include "command_table.h"
+#include "lexer.h"
+#include "arena.h"
+#include "command_stats.h"
 #include "clioutput.h"
+#include "wire_format.h"
+#include "command_journal.h"
+#include "cli_error.h"
+
+// Outcome of one entry of a batch.
+struct DispatchResult {
+	bool success;
+	const char* error; // First error reported for the entry, or null
+	CLIErrorCode code; // Code of that error, or CLI_ERROR_NONE
+	size_t offset;     // Byte offset of its token within the entry, or CLI_ERROR_NO_POSITION
+};
 
 // The Dispatcher class is responsible for tokenizing, parsing, and executing CLI commands.
 class Dispatcher {
 public:
 	typedef std::function<void(const std::string&)> ErrorCallback;
+	typedef std::function<void(const CLIError&)> ErrorHandler;
 	Dispatcher();
 
+	// Create a dispatcher that runs commands from the command tree of `source` instead of its own.
+	// source must be frozen and outlive this dispatcher, and nothing may register on it afterwards.
+	// Each such dispatcher has its own arena, batch state and statistics totals, so several of them
+	// can dispatch at the same time on different threads (see DispatchPool). They start with
+	// source's output and error callback, which must then be safe to call from those threads.
+	// They keep no per-command statistics. A command with only a legacy CommandCallback fails
+	// with ERROR_CMD_NO_CALLBACK, since that callback reads arguments bound into the shared command.
+	explicit Dispatcher(const Dispatcher* source);
+
 	CLIOutput* output;
 
-	// Report an error message to the registered output.
-	void reportError(const std::string& msg);
+	// Report a structured error. A registered error handler receives it as it is; otherwise it
+	// is turned into the message the two macro modes have always produced: with
+	// USE_DESCRIPTIVE_ERRORS its text is printed to the output, and without it the error
+	// callback gets its ERROR_CMD_* code.
+	void reportError(const CLIError& error);
 
 	// Register an error callback for handling errors.
 	void registerErrorCallback(ErrorCallback callback);
 
+	// Receive every error as a CLIError instead, in either macro mode: its code, the offending
+	// token and its offset, and the command and ArgSpec involved. Nothing is allocated to report
+	// it, so a flood of malformed input costs no more than parsing it; render the text with
+	// error.render() or error.print() only where it is wanted. Errors inside dispatchBatch and
+	// ScriptRunner are still recorded in their results. Pass an empty handler to go back to
+	// the error callback. Errors of building a command tree come before any dispatcher is
+	// involved; see Command::registerErrorHandler.
+	void registerErrorHandler(ErrorHandler handler);
+
 	// Register an output interface for printing CLI messages.
 	void registerOutput(CLIOutput* output);
 
 	// Register a top‑level command; returns true if successful, false if an error occurred.
+	// The rvalue overload moves cmd and its subtree into place instead of copying them, so a
+	// tree built bottom-up with addSubcommand(std::move(child)) is never copied.
 	bool registerCommand(const Command& cmd);
+	bool registerCommand(Command&& cmd);
+
+	// Finish registration: release the spare capacity of the command tree and its indexes, render
+	// the help text of every command and number the commands in depth-first order (Command::id)
+	// for binary frames. Later registerCommand calls fail with ERROR_CMD_FROZEN.
+	void freeze();
+	bool isFrozen() const { return frozen; }
+
+	// Find the registered command at path, e.g. "net wifi"; returns a null pointer if there is none.
+	// After freeze() this is the command to build an ExecutableCommand from for encoding.
+	const Command* findCommand(const char* path) const;
+
+	// Dispatch against a constant command table (see command_table.h) as well as the registered
+	// commands, which take precedence over table entries with the same name. Only the pointer
+	// is stored, so the table must outlive the dispatcher; registering another table replaces it.
+	// A table with an entry of more than MAX_ARG_SPECS arguments is refused with
+	// CLI_ERROR_TOO_MANY_ARGS, leaving no table registered, and false is returned.
+	bool registerTable(const TableCommand* table, size_t count);
+	template <size_t N>
+	bool registerTable(const TableCommand (&entries)[N]) { return registerTable(entries, N); }
 
 	// Parse an input string, validate arguments, and execute the matching command.
 	// The input may contain multiple commands separated by ';'. Returns true on success, false on error.
 	bool dispatch(const std::string& input);
 
+	// Same as above, but lexes the caller's buffer in place without copying it.
+	bool dispatch(const char* input, size_t length);
+
+	// Match, parse and execute a single command that has already been split into tokens,
+	// e.g. by a Lexer or StreamParser. The tokens must point into a live buffer.
+	bool dispatchTokens(const TokenList& tokens);
+
+	// Execute a binary frame (see wire_format.h) encoded against the same frozen tree. Arguments are
+	// decoded straight into their slots, checked against the specs and bound as for text input,
+	// without lexing. A command that fails does not stop the rest, but a malformed frame or an
+	// unknown command id ends it with ERROR_CMD_MALFORMED_FRAME or ERROR_CMD_UNKNOWN, since the
+	// remaining bytes cannot be trusted. Returns true if every command succeeded.
+	bool dispatchFrame(const uint8_t* frame, size_t length);
+
+	// Dispatch many command lines in one call, one entry in results per line. A line may hold
+	// several ';'-separated commands. Errors are recorded in the results instead of being
+	// reported, so the error callback is not called; their texts stay valid until the next batch.
+	// Returns the number of entries that succeeded.
+	size_t dispatchBatch(const std::vector<std::string>& lines, std::vector<DispatchResult>& results);
+
+	// Same as above for a buffer holding one command line per '\n', lexed in place.
+	size_t dispatchBatch(const char* input, size_t length, std::vector<DispatchResult>& results);
+
+	// Record every registered command that runs successfully in journal, or stop recording if
+	// journal is null. Records refer to commands by id, so call freeze() first; command table
+	// entries have no id and are not recorded. The journal must outlive the dispatcher or be detached.
+	void setJournal(CommandJournal* journal) { this->journal = journal; }
+	CommandJournal* getJournal() const { return journal; }
+
+	// Run every record of journal through the callbacks of this dispatcher's tree, which must be
+	// the tree it was recorded against. Records are decoded straight into their arguments, as
+	// binary frames are, and are not journaled again. Returns the number that succeeded.
+	size_t replay(const CommandJournal& journal);
+
+	// Use a fixed buffer for per-dispatch memory instead of heap blocks, so dispatching never
+	// touches the global heap. Pass a null buffer to go back to heap blocks.
+	// A command that needs more than the buffer fails with ERROR_CMD_OUT_OF_MEMORY.
+	void setArenaBuffer(void* buffer, size_t size);
+
+	// Per-dispatch memory, reset after every top-level dispatch.
+	const Arena& getArena() const { return arena; }
+
+#ifdef USE_COMMAND_STATS
+	// Totals over all commands. Unknown commands and input rejected before matching only count here;
+	// per-command counters are in each Command's `stats`.
+	const CommandStats& getStats() const { return stats; }
+
+	// Clear the totals and the counters of every registered command and subcommand.
+	void resetStats();
+
+	// Print the totals and every command that has been dispatched, with its errors by code
+	// and its parse and callback latency percentiles.
+	void printStats(CLIOutput* out = nullptr) const;
+
+	// Register a built-in command that prints the statistics, or clears them when run with -reset true.
+	bool registerStatsCommand(const std::string& name = "stats");
+
+	// Count a dispatch error against cmd (if not null) and the totals.
+	void recordError(const Command* cmd, StatsError error);
+#endif
+
+#ifdef USE_SUGGESTIONS
+	// The registered names closest to the unknown command, subcommand or argument being reported,
+	// for the error callback to offer. Only set while the callback for ERROR_CMD_UNKNOWN,
+	// ERROR_CMD_UNEXPECTED_TOKEN or ERROR_CMD_UNKNOWN_ARG runs, and handed to an error handler as
+	// CLIError::suggestions; with USE_DESCRIPTIVE_ERRORS they are appended to the message
+	// instead. Command table entries are not suggested.
+	const Suggestions& getSuggestions() const { return suggestions; }
+#endif
+
 	// Print global help for all registered commands.
 	void printGlobalHelp() const;
 
+	// Print the help of the command at path, e.g. "net wifi", or of every command if path is empty.
+	// Only lines [offset, offset + limit) are written, all of them if limit is 0, so long help can be
+	// sent a page at a time. Returns the total number of lines, or 0 if no command matches path.
+	size_t printHelp(const char* path = "", size_t offset = 0, size_t limit = 0, CLIOutput* out = nullptr) const;
+
+	// Register a built-in command that prints help, optionally for one -command and one -page
+	// of -lines lines at a time.
+	bool registerHelpCommand(const std::string& name = "help");
+
 	// Get the current output interface.
 	CLIOutput* getOutput();
 private:
+	// The microbenchmarks in examples/benchmark time the private pipeline stages directly.
+	friend struct DispatcherBench;
+	// Scripts record errors with their position through the batch machinery.
+	friend class ScriptRunner;
+	// Completion walks the command tree and its name index.
+	friend class Completer;
+
 	ErrorCallback errorCallback;
+	ErrorHandler errorHandler;
 	std::vector<Command> commands;
+	CommandIndex commandIndex; // Name and alias index over top-level commands
+	const TableCommand* table; // Top-level entries of the registered command table, or null
+	size_t tableSize;
+	bool frozen;
+	const Dispatcher* shared;  // Dispatcher whose command tree is used instead of this one's, or null
+	std::vector<const Command*> commandsById; // Every command of the frozen tree, indexed by Command::id
 
-	// Tokenize an input string into individual tokens.
-	std::vector<std::string> tokenize(const std::string& input);
+	// The dispatcher holding the command tree in use.
+	const Dispatcher& tree() const { return shared ? *shared : *this; }
+
+	// Report and return false if cmd cannot be registered: the dispatcher is frozen,
+	// or cmd's name or an alias is already taken.
+	bool canRegister(const Command& cmd);
+#ifdef USE_COMMAND_STATS
+	CommandStats stats;
+#endif
+#ifdef USE_SUGGESTIONS
+	Suggestions suggestions; // Looked up only once a name has failed to match
+#endif
+
+	// Tokens, arguments and values of the current dispatch all live here and are released
+	// together when the outermost dispatch returns.
+	Arena arena;
+	int dispatchDepth;
+	const char* input; // Start of the text being dispatched, which error offsets count from, or null
+
+	// Point error at tokens[index] of the command being dispatched.
+	void locateToken(CLIError& error, const TokenList& tokens, size_t index) const { error.setToken(tokens, index, input); }
+
+	// Sets the text that error offsets count from for the lifetime of the scope, so that a
+	// dispatch from inside a callback does not move the offsets of the one around it.
+	class InputScope {
+	public:
+		InputScope(Dispatcher& d, const char* text) : dispatcher(d), outer(d.input) { dispatcher.input = text; }
+		~InputScope() { dispatcher.input = outer; }
+	private:
+		Dispatcher& dispatcher;
+		const char* outer;
+	};
+
+	// Tracks nesting so that only the outermost dispatch resets the arena and flushes the output.
+	class DispatchScope {
+	public:
+		DispatchScope(Dispatcher& d) : dispatcher(d) { dispatcher.dispatchDepth++; }
+		~DispatchScope() {
+			if (--dispatcher.dispatchDepth == 0) {
+				dispatcher.arena.reset();
+				if (dispatcher.output)
+					dispatcher.output->flush();
+			}
+		}
+	private:
+		Dispatcher& dispatcher;
+	};
+
+	typedef std::vector<int, ArenaAllocator<int> > SlotList;
+
+	CommandJournal* journal; // Journal receiving successful commands, or null
+	bool replaying;          // A journal is being replayed, so nothing is recorded
+
+	// Decode and run one journal record.
+	bool replayRecord(const uint8_t* record, size_t length);
+
+	DispatchResult* batchEntry;             // Entry receiving errors while a batch runs, or null
+	std::deque<std::string> batchMessages;  // Descriptive error texts of the current batch
+
+	// Records errors into a batch entry instead of reporting them, for the lifetime of the scope.
+	class BatchScope {
+	public:
+		BatchScope(Dispatcher& d, DispatchResult& entry) : dispatcher(d) { dispatcher.batchEntry = &entry; }
+		~BatchScope() { dispatcher.batchEntry = 0; }
+	private:
+		Dispatcher& dispatcher;
+	};
+
+	void dispatchBatchEntry(const char* input, size_t length, std::vector<DispatchResult>& results);
+
+	bool dispatchTokensInScope(const TokenList& tokens);
 
 	// Match the command from tokens and update the token index.
-	const Command* matchCommand(const std::vector<std::string>& tokens, size_t& index);
+	const Command* matchCommand(const TokenList& tokens, size_t& index);
+
+	// Same as above against the command table.
+	const TableCommand* matchTable(const TokenList& tokens, size_t& index);
+
+	// Parsing, binding and invoking work the same for registered commands and table entries;
+	// these views give both the interface the templates below expect.
+	struct CommandSpecs {
+		const Command& cmd;
+		bool concurrent; // The command belongs to a tree shared with other threads
+		explicit CommandSpecs(const Command& c, bool isShared = false) : cmd(c), concurrent(isShared) {}
+		const Command* statsCommand() const { return concurrent ? 0 : &cmd; } // Command whose statistics are updated, or null
+		const Command* journalCommand() const { return &cmd; } // Command to record in the journal, or null
+		// Point error at the command and, if slot is not negative, at that argument's spec.
+		void locate(CLIError& error, int slot = -1) const {
+			error.command = &cmd;
+			error.argSpec = slot >= 0 ? &cmd.argSpecs[slot] : 0;
+		}
+		bool variadic() const { return cmd.variadic; } // Flags without a spec are ignored even with USE_SUGGESTIONS
+		size_t count() const { return cmd.argSpecs.size(); }
+		int slot(const char* name, size_t length) const { return cmd.argSlot(name, length); }
+		ArgumentName name(size_t slot) const { return ArgumentName(cmd.argSpecs[slot].name); }
+		ValueType type(size_t slot) const { return cmd.argSpecs[slot].type; }
+		bool required(size_t slot) const { return cmd.argSpecs[slot].required; }
+		bool hasDefault(size_t slot) const { return cmd.argSpecs[slot].hasDefault; }
+		Value defaultValue(size_t slot) const { return Value::borrow(cmd.argSpecs[slot].defaultValue); }
+		void printUsage(CLIOutput* out) const { cmd.printUsage("", out); }
+#ifdef USE_SUGGESTIONS
+		void suggestSubcommands(const Token& token, Suggestions& out) const { cmd.suggestSubcommands(token.data, token.length, out); }
+		void suggestArguments(const char* name, size_t length, Suggestions& out) const { cmd.suggestArguments(name, length, out); }
+#endif
+		bool invoke(ArgumentList& args, CLIOutput* out, const int* slots, Dispatcher* owner) const {
+			if (concurrent && !cmd.invocationCallback)
+				return false;
+			return cmd.invoke(args, out, slots, owner);
+		}
+	};
+
+	struct TableSpecs {
+		const TableCommand& cmd;
+		explicit TableSpecs(const TableCommand& c) : cmd(c) {}
+		const Command* statsCommand() const { return 0; } // Table entries are read-only, so they keep no statistics
+		const Command* journalCommand() const { return 0; } // Table entries have no id to record
+		void locate(CLIError& error, int slot = -1) const {
+			error.tableCommand = &cmd;
+			error.tableArgSpec = slot >= 0 ? &cmd.argSpecs[slot] : 0;
+		}
+		bool variadic() const { return cmd.variadic; }
+		size_t count() const { return cmd.argCount; }
+		int slot(const char* name, size_t length) const { return cmd.argSlot(name, length); }
+		ArgumentName name(size_t slot) const { return ArgumentName(cmd.argSpecs[slot].name.text); }
+		ValueType type(size_t slot) const { return cmd.argSpecs[slot].type; }
+		bool required(size_t slot) const { return cmd.argSpecs[slot].required; }
+		bool hasDefault(size_t slot) const { return cmd.argSpecs[slot].hasDefault(); }
+		Value defaultValue(size_t slot) const { return cmd.argSpecs[slot].defaultAsValue(); }
+		void printUsage(CLIOutput* out) const { cmd.printUsage("", out); }
+#ifdef USE_SUGGESTIONS
+		// Tables are constant data with no suggestion index.
+		void suggestSubcommands(const Token&, Suggestions& out) const { out.count = 0; }
+		void suggestArguments(const char*, size_t, Suggestions& out) const { out.count = 0; }
+#endif
+		bool invoke(ArgumentList& args, CLIOutput* out, const int* slots, Dispatcher* owner) const {
+			if (!cmd.callback)
+				return false;
+			cmd.callback(Invocation(cmd, args, out, slots, owner));
+			return true;
+		}
+	};
+
+	// Check the tokens after the command, parse and bind its arguments, then print its usage
+	// or invoke it. started is the statistics clock at the start of the dispatch.
+	template <class Specs>
+	bool runCommand(const Specs& specs, const TokenList& tokens, size_t index, uint32_t started);
+
+	// Bind parsed arguments and invoke the command; the part of runCommand shared with binary frames.
+	template <class Specs>
+	bool invokeParsed(const Specs& specs, ArgumentList& parsedArgs, SlotList& slotPositions, uint32_t started);
+
+	// Decode and run the next command of a binary frame. intact is cleared if the frame cannot be
+	// read past this command.
+	bool dispatchWireCommand(WireReader& reader, bool& intact);
+
+	// Decode the arguments of a binary command into outArgs, converting them to the declared types.
+	// Returns false on error; intact is cleared if the error left the reader out of step.
+	bool decodeWireArguments(WireReader& reader, const CommandSpecs& specs, ArgumentList& outArgs,
+		SlotList& slotPositions, bool& intact);
+
+	// Parse the arguments of a command from tokens starting at index; returns false on error.
+	// Each flag is resolved to its spec slot once; slotPositions[slot] receives the argument's
+	// position in outArgs. Sets help if -h or -help was given.
+	template <class Specs>
+	bool parseArguments(const TokenList& tokens, size_t index, const Specs& specs,
+		ArgumentList& outArgs, SlotList& slotPositions, bool& help);
+
+	// Validate parsed arguments against the command's specs and move them, plus defaults, into
+	// mergedArgs in slot order; slotPositions is remapped to positions in mergedArgs. Returns false on error.
+	template <class Specs>
+	bool bindArguments(const Specs& specs, ArgumentList& parsedArgs, SlotList& slotPositions,
+		ArgumentList& mergedArgs);
+
+	// Convert a token straight to the declared type: ints widen to doubles, quotes are removed,
+	// and any text is a valid string. Returns false if the token is not a valid value of that type,
+	// or if a fixed arena has no room for it, in which case the arena has overflowed.
+	// VAL_NONE falls back to guessing the type with parseValue.
+	bool parseTypedValue(const Token& token, ValueType type, Value& out);
+
+	// Parse a token into a Value, guessing its type; VAL_NONE if a fixed arena has no room for it.
+	Value parseValue(const Token& token);
+	Value parseValue(const char* token, size_t length);
+
+	// Parse a token representing a list into a Value of type list, with nested lists as list
+	// elements. Returns false if the brackets do not balance or lists nest deeper than LIST_MAX_DEPTH.
+	bool parseList(const Token& token, Value& out);
 
-	// Parse the arguments from tokens starting at index; returns false on error.
-	bool parseArguments(const std::vector<std::string>& tokens, size_t index, std::vector<Argument>& outArgs);
+	// Parse the list opening at text[position] and advance position past its closing bracket.
+	// depth is the number of enclosing lists.
+	bool parseListAt(const char* text, size_t length, size_t& position, unsigned depth, Value& out);
 
-	// Parse a token into a Value.
-	Value parseValue(const std::string& token);
+	// Parse one item of a list that is not itself a list, ending at a delimiter or bracket outside
+	// quotes, and append it to list unless it is empty. Returns false if the arena is full.
+	bool parseListItem(const char* text, size_t length, size_t& position, Value& list);
 
-	// Parse a token representing a list into a Value of type list.
-	Value parseList(const std::string& token);
+	// Dispatch a single command span.
+	bool dispatchSingleCommand(const Token& command);
 
-	// Dispatch a single command string (after cleanup).
-	bool dispatchSingleCommand(const std::string& command);
+	// Report that the command does not fit in the fixed arena; returns false.
+	template <class Specs>
+	bool outOfMemory(const Specs& specs);
 };
 
 #endif
@@ -8,18 +8,31 @@
 #include "command.h"
 #include "argument.h"
 #include "value.h"
+#include "wire_format.h"
+
+#define EXECUTE_ARGS_BUFFER_SIZE 512 // Stack space for the arguments of executeWithArgs before it falls back to the heap
 
 // Class representing a command with pre-defined argument values.
+// It refers to the base command instead of copying it, so the command must outlive it; use a
+// command registered with a Dispatcher (see Dispatcher::findCommand), whose tree does not move
+// once frozen. The preset arguments are resolved to their slots when they are set, so
+// execute() only hands them to the callback and does not touch the heap.
 class ExecutableCommand {
 public:
-	ExecutableCommand() = default;
+	ExecutableCommand() : baseCommand(0) {}
 	ExecutableCommand(const Command& baseCmd, const std::vector<Argument>& presetArgs);
 	ExecutableCommand(const Command& baseCmd, std::initializer_list<std::pair<std::string, Value>> presetArgsList);
+	// The base command is referred to, not copied, so a temporary one is refused.
+	ExecutableCommand(Command&&, const std::vector<Argument>&) = delete;
+	ExecutableCommand(Command&&, std::initializer_list<std::pair<std::string, Value>>) = delete;
+	ExecutableCommand(const ExecutableCommand& other);
+	ExecutableCommand& operator=(const ExecutableCommand& other);
 
 	// Executes the command by calling the base command's callback with the preset arguments.
 	bool execute() const;
 
 	// Executes the command by calling the base command's callback with the provided arguments.
+	// Names and values are borrowed rather than copied; only a long list of them needs the heap.
 	bool executeWithArgs(std::initializer_list<std::pair<std::string, Value>> argsList) const;
 
 	// Returns a string representation of the command in the form:
@@ -32,14 +45,31 @@ public:
 	// Prints to the base command's output the command with the provided arguments.
 	void toOutputWithArgs(std::initializer_list<std::pair<std::string, Value>> argsList) const;
 
+	// Appends the command to a binary frame (see wire_format.h) for Dispatcher::dispatchFrame.
+	// The base command must come from a frozen tree, e.g. Dispatcher::findCommand, so that it has an
+	// id. Values are converted to their ArgSpec's type as text input would read them, e.g. 5 for a
+	// string argument is sent as "5". Presets without an ArgSpec are left out, since a frame can
+	// only name arguments by slot. Returns false if a value does not convert, the writer is out of
+	// room, or, with USE_SUGGESTIONS, a preset has no ArgSpec on a command that is not variadic.
+	bool encode(WireWriter& writer) const;
+
+	// Encodes the command as a frame of its own; returns the frame size, or 0 on error.
+	size_t encode(uint8_t* out, size_t size) const;
+
 	const Command& getBaseCommand() const;
 
-	std::vector<Argument> getPresetArgs() const;
+	const ArgumentList& getPresetArgs() const;
 	void setArgs(const std::vector<Argument>& presetArgs);
 
 private:
-	Command baseCommand;
-	std::vector<Argument> presetArgs;
+	const Command* baseCommand;
+	// Mutable because legacy callbacks swap them into the command while they run, and swap them back.
+	mutable ArgumentList presetArgs;
+	std::vector<int> slotPositions; // Slot of baseCommand to position in presetArgs, -1 if not preset
+	std::vector<std::string> unslottedNames; // Names of preset arguments without an ArgSpec, which presetArgs point at
+
+	void bindSlots();
+	bool invoke(ArgumentList& args, const int* slots) const;
 };
 
 // Class representing a sequence of executable commands.
@@ -55,6 +85,9 @@ public:
 	// Returns a string representing the entire sequence.
 	std::string toString() const;
 
+	// Encodes the whole sequence as one binary frame; returns the frame size, or 0 on error.
+	size_t encode(uint8_t* out, size_t size) const;
+
 private:
 	std::vector<ExecutableCommand> commands;
 };
@@ -0,0 +1,47 @@
+// include/help_writer.h
+#ifndef HELP_WRITER_H
+#define HELP_WRITER_H
+
+#include <cstddef>
+#include "clioutput.h"
+
+#define HELP_INDENT_STEP 4 // Extra indentation of each subcommand level
+
+// Streams help text to a CLIOutput line by line, writing indentation and text straight to the
+// output instead of concatenating strings. Only the lines in the window [offset, offset + limit)
+// are written, so help can be sent a page at a time; all lines are still counted.
+// Lines end through the output's println(), so each output keeps its own line ending (CRLF on Serial).
+class HelpWriter {
+public:
+	// A limit of 0 writes every line from offset on.
+	HelpWriter(CLIOutput* out, size_t offset = 0, size_t limit = 0);
+
+	// Text written at the start of every line, before the indentation; it must outlive the writer.
+	void setPrefix(const char* text, size_t length);
+
+	// Write one line: the prefix, indent spaces, then the text, then a line end.
+	void line(size_t indent, const char* text, size_t length);
+
+	// Write a line in pieces: beginLine, any number of text calls, then endLine.
+	void beginLine(size_t indent);
+	void text(const char* s, size_t length);
+	void text(const char* s);
+	void endLine();
+
+	// Write every '\n'-terminated line of a block, each with indent spaces in front.
+	void block(size_t indent, const char* text, size_t length);
+
+	// Lines seen so far, whether written or not.
+	size_t getLines() const { return lines; }
+
+private:
+	CLIOutput* output;
+	size_t offset;
+	size_t limit;
+	size_t lines;
+	const char* prefix;
+	size_t prefixLength;
+	bool visible; // The current line is inside the window
+};
+
+#endif
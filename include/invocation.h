@@ -0,0 +1,60 @@
+// include/invocation.h
+#ifndef INVOCATION_H
+#define INVOCATION_H
+
+#include <string>
+#include <vector>
+#include "argument.h"
+#include "clioutput.h"
+
+class Command;
+class Dispatcher;
+struct TableCommand;
+
+// A single call of a command: a pointer to the command plus its parsed arguments.
+// It is handed to callbacks instead of a copy of the command, so the command tree is never copied.
+class Invocation {
+public:
+	const Command* command;           // The registered command, or null for a command table entry
+	const TableCommand* tableCommand; // The command table entry, or null for a registered command
+	const ArgumentList& arguments;
+	CLIOutput* output;
+	Dispatcher* dispatcher; // Dispatcher running the command, or null when it is invoked directly
+
+	Invocation(const Command& cmd, const ArgumentList& args, CLIOutput* out = nullptr, const int* slots = nullptr,
+		Dispatcher* owner = nullptr)
+		: command(&cmd), tableCommand(0), arguments(args), output(out), dispatcher(owner), slotPositions(slots) {
+	}
+
+	// Table commands are always invoked with slot positions.
+	Invocation(const TableCommand& entry, const ArgumentList& args, CLIOutput* out, const int* slots,
+		Dispatcher* owner = nullptr)
+		: command(0), tableCommand(&entry), arguments(args), output(out), dispatcher(owner), slotPositions(slots) {
+	}
+
+	// Find an argument by name; returns a null pointer if it was not provided and has no default.
+	const Argument* find(const std::string& name) const;
+
+	// Return the first value of the named argument, or a null pointer if it is absent.
+	const Value* get(const std::string& name) const;
+
+	// Typed accessors by slot, the position of the argument's ArgSpec in the command's argSpecs.
+	// Slots follow addArgSpec order (or table order) and can be resolved once with argSlot, so these
+	// do no string comparisons. The fallback is returned if the argument is absent.
+	const Value* value(size_t slot) const;
+	bool has(size_t slot) const { return value(slot) != 0; }
+	int getInt(size_t slot, int fallback = 0) const;
+	double getDouble(size_t slot, double fallback = 0.0) const;
+	bool getBool(size_t slot, bool fallback = false) const;
+	const char* getString(size_t slot, const char* fallback = "") const;
+	const ValueList* getList(size_t slot) const;
+
+private:
+	const int* slotPositions; // Slot to position in arguments, or null to look up by name
+
+	Invocation& operator=(const Invocation&);
+};
+
+typedef void (*InvocationCallback)(const Invocation&);
+
+#endif
@@ -0,0 +1,94 @@
+// include/lexer.h
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "arena.h"
+
+#define QUOTE_CHAR '"'
+#define ESCAPE_CHAR '\\'
+#define LIST_START '['
+#define LIST_END ']'
+#define COMMAND_DELIMITER ';'
+
+enum TokenFlags {
+	TOKEN_PLAIN = 0,
+	TOKEN_QUOTED = 1, // Contains quotes or escapes that must be removed when the text is read
+	TOKEN_LIST = 2    // Starts with a list bracket
+};
+
+// A token is a span into the caller's input buffer; no characters are copied while lexing.
+// The buffer must outlive the token.
+struct Token {
+	const char* data;
+	size_t length;
+	unsigned char flags;
+
+	Token() : data(0), length(0), flags(TOKEN_PLAIN) {}
+	Token(const char* d, size_t len, unsigned char f = TOKEN_PLAIN) : data(d), length(len), flags(f) {}
+
+	bool isQuoted() const { return (flags & TOKEN_QUOTED) != 0; }
+	bool isList() const { return (flags & TOKEN_LIST) != 0; }
+
+	// Compare the raw span against a NUL-terminated string.
+	bool equals(const char* s) const;
+
+	// Return the token text with quotes and escapes resolved.
+	// This is the only place a token allocates, so it is only called when a value is read.
+	std::string str() const;
+	void appendTo(std::string& out) const;
+
+	// Write the resolved text to out, which must hold at least `length` bytes; returns its length.
+	size_t unquoteTo(char* out) const;
+};
+
+typedef std::vector<Token, ArenaAllocator<Token> > TokenList;
+
+// Lists may nest and may hold quoted items; a list token ends at the bracket closing its first one.
+enum TokenizerState { TS_OUTSIDE, TS_IN_QUOTE, TS_IN_ESCAPE, TS_IN_LIST, TS_IN_LIST_QUOTE, TS_IN_LIST_ESCAPE };
+
+// Tokenizer state machine. It can run over a whole buffer (tokenize) or be advanced one
+// character at a time over a buffer that grows, keeping quote, escape and list state between calls.
+class Lexer {
+public:
+	Lexer() { reset(); }
+
+	// Forget any partial token and return to the outside state.
+	void reset();
+
+	// Advance over input[position]. A token completed by this character is appended to out.
+	// The functions that append to out return false if it lives in a fixed arena without room
+	// for another token.
+	bool step(const char* input, size_t position, TokenList& out);
+
+	// Close the pending token, if any, as ending just before position.
+	bool finish(const char* input, size_t position, TokenList& out);
+
+	TokenizerState getState() const { return state; }
+	bool hasPendingToken() const { return content > 0; }
+
+	// Split input into trimmed, non-empty command spans separated by ';'.
+	// Delimiters inside quotes or lists do not split.
+	static bool splitCommands(const char* input, size_t length, TokenList& out);
+
+	// The state machine shared by the lexer and splitCommands: the state after c, seen in state.
+	// depth counts the open list brackets. A ';' only ends a command in TS_OUTSIDE.
+	static TokenizerState splitStep(TokenizerState state, unsigned& depth, char c);
+
+	// Split a single command into whitespace-separated tokens.
+	static bool tokenize(const char* input, size_t length, TokenList& out);
+
+	// Narrow a span so it has no leading or trailing whitespace.
+	static Token trim(const Token& token);
+
+private:
+	TokenizerState state;
+	unsigned depth;       // Open list brackets of the pending token
+	size_t begin;         // Start of the pending token
+	size_t content;       // Characters of the pending token that survive quote removal
+	unsigned char flags;  // TokenFlags of the pending token
+};
+
+#endif
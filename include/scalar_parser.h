@@ -0,0 +1,32 @@
+// include/scalar_parser.h
+#ifndef SCALAR_PARSER_H
+#define SCALAR_PARSER_H
+
+#include <cstddef>
+
+enum ScalarKind {
+	SCALAR_NONE,   // Not a number or bool; the token is a string
+	SCALAR_INT,
+	SCALAR_DOUBLE,
+	SCALAR_BOOL
+};
+
+struct Scalar {
+	ScalarKind kind;
+	bool overflow; // Integer syntax outside the int range; the value is kept as a double instead
+	union {
+		int intValue;
+		double doubleValue;
+		bool boolValue;
+	};
+};
+
+// Classify a token as int, double or bool and convert it in the same pass over the text.
+// The text needs no terminator and is read the same way in every locale.
+// Accepted forms are those of std::from_chars in decimal, plus an optional leading '+':
+// integers ("-42"), decimals with optional fraction and exponent (".5", "1e-3"), "inf",
+// "infinity" and "nan" in any case, and the exact words "true" and "false".
+// Integers that do not fit an int are returned as doubles with `overflow` set, so they are never truncated.
+ScalarKind parseScalar(const char* text, size_t length, Scalar& out);
+
+#endif
@@ -0,0 +1,65 @@
+// include/script_runner.h
+#ifndef SCRIPT_RUNNER_H
+#define SCRIPT_RUNNER_H
+
+#include <vector>
+#include <cstddef>
+#include "dispatcher.h"
+#include "lexer.h"
+
+enum ScriptMode {
+	SCRIPT_CONTINUE,     // Run every command, recording each failure
+	SCRIPT_STOP_ON_ERROR // Stop at the first command that fails
+};
+
+// A command of a script that failed.
+// The position is that of the offending token, or of the command's first character when the
+// error has no token, such as a missing required argument.
+struct ScriptError {
+	size_t line;   // 1-based line of the command
+	size_t column; // 1-based byte column of the position
+	size_t offset; // Byte offset of the position in the script
+	const char* error; // First error reported for the command
+	CLIErrorCode code; // Code of that error
+};
+
+// Runs scripts such as provisioning files, which can be tens of thousands of lines long.
+// The script is read in place, from a caller buffer or a file mapped into memory: it is split
+// with the lexer's quote- and list-aware state machine, and each command is tokenized and
+// dispatched where it lies, without copying lines. Commands end at ';' or at a line end,
+// which always ends a command, as with StreamParser.
+// Errors are recorded with the command's position instead of being passed to the error callback.
+// Descriptive texts stay valid until the next run or dispatchBatch.
+class ScriptRunner {
+public:
+	explicit ScriptRunner(Dispatcher& dispatcher, ScriptMode mode = SCRIPT_CONTINUE);
+
+	void setMode(ScriptMode mode) { this->mode = mode; }
+
+	// Run the script in input. Returns true if every command succeeded.
+	bool run(const char* input, size_t length);
+
+#ifdef RAPTORCLI_MMAP
+	// Map the file at path read-only and run it as above. Also returns false if the file cannot
+	// be read, in which case no command runs.
+	bool runFile(const char* path);
+#endif
+
+	// Results of the last run.
+	size_t getCommands() const { return commands; }   // Commands dispatched
+	size_t getSucceeded() const { return succeeded; }
+	const std::vector<ScriptError>& getErrors() const { return errors; }
+
+private:
+	Dispatcher& dispatcher;
+	ScriptMode mode;
+	TokenList tokens; // Reused for every command, so it stops growing after the first few
+	std::vector<ScriptError> errors;
+	size_t commands;
+	size_t succeeded;
+
+	// Dispatch the command span at input[begin, end) of the given line; returns false on error.
+	bool runCommand(const char* input, size_t begin, size_t end, size_t line, size_t lineStart);
+};
+
+#endif
@@ -0,0 +1,59 @@
+// include/stream_parser.h
+#ifndef STREAM_PARSER_H
+#define STREAM_PARSER_H
+
+#include <vector>
+#include <cstddef>
+#include "lexer.h"
+
+#define STREAM_DEFAULT_CAPACITY 256 // Bytes of a single command held by a StreamParser
+#define LINE_END '\n'
+
+class Dispatcher;
+
+// Incremental front end for byte streams such as UART or LoRa links.
+// Bytes are fed as they arrive; tokens are emitted as soon as they are complete and each
+// command is dispatched when its ';' or end of line is received, so no line buffer is needed.
+// Memory use is fixed at construction: a command longer than the capacity is reported with
+// ERROR_CMD_INPUT_TOO_LONG and the rest of it is discarded without being stored.
+class StreamParser {
+public:
+	// Use an internal buffer of the given size.
+	StreamParser(Dispatcher& dispatcher, size_t capacity = STREAM_DEFAULT_CAPACITY);
+
+	// Use a caller-provided buffer, e.g. a static array, so the parser never touches the heap for text.
+	StreamParser(Dispatcher& dispatcher, char* buffer, size_t capacity);
+
+	~StreamParser();
+
+	// Feed received bytes. Returns false if any command completed by these bytes failed or was too long.
+	bool feed(const char* data, size_t length);
+	bool feed(char c);
+
+	// Dispatch whatever has been received so far as a complete command, e.g. on a receive timeout.
+	bool flush();
+
+	// Drop the pending command and all lexer state.
+	void reset();
+
+	size_t getCapacity() const { return capacity; }
+	size_t getPendingLength() const { return length; }
+
+private:
+	Dispatcher& dispatcher;
+	char* buffer;
+	size_t capacity;
+	size_t length;        // Bytes of the pending command stored in buffer
+	bool ownsBuffer;
+	bool discarding;      // The pending command overflowed; skip to its end
+	Lexer lexer;
+	TokenList tokens;
+
+	StreamParser(const StreamParser&);
+	StreamParser& operator=(const StreamParser&);
+
+	void init();
+	bool endCommand();
+};
+
+#endif
@@ -0,0 +1,89 @@
+// include/suggestion_index.h
+#ifndef SUGGESTION_INDEX_H
+#define SUGGESTION_INDEX_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+// "Did you mean" suggestions are only built when USE_SUGGESTIONS is defined. Like
+// USE_COMMAND_STATS it adds members to CommandIndex and Dispatcher, so it must be defined for
+// the whole build (-DUSE_SUGGESTIONS or a build flag).
+
+#define SUGGEST_MAX 3          // Suggestions returned by one lookup
+#define SUGGEST_MAX_DISTANCE 2 // Most typos a suggestion may be away from the token
+#define SUGGEST_MAX_LENGTH 32  // Longer tokens get no suggestions
+
+// The closest names found for a token, best first.
+struct Suggestions {
+	const char* names[SUGGEST_MAX];
+	size_t count;
+
+	Suggestions() : count(0) {}
+};
+
+// Index over a set of names answering "which names are a typo or two away from this token",
+// with a cost that depends on the token's length but not on the number of names.
+// A typo is an insertion, deletion or substitution of a character, or a swap of two adjacent
+// ones. Tokens of 3 to 6 characters are matched within one typo, longer ones within two. Two
+// strings are that close only if deleting as many characters from each can make them equal,
+// so every name is indexed under the hashes of itself with each combination of up to that
+// many characters deleted, for its own length. A lookup hashes the token's deletions the same
+// way and computes the edit distance only for the names found under them.
+// A name of n characters takes about n * n / 2 entries of 8 to 24 bytes if it is 7 or more
+// characters long, and n + 1 if it is shorter.
+// Names are copied into the index, which refers to their owners by position, so it stays
+// valid when the indexed vector is copied.
+class SuggestionIndex {
+public:
+	SuggestionIndex();
+
+	// Index name, which belongs to the item at position (a command, or a spec).
+	void insert(const char* name, size_t length, uint32_t position);
+
+	// Fill out with the names closest to token, at most one per item: fewest typos first, then
+	// the earliest indexed. The names stay valid until the next insert.
+	void suggest(const char* token, size_t length, Suggestions& out) const;
+
+	void clear();
+
+	// Rebuild the table at the smallest size that keeps the load factor at or below one half.
+	void shrinkToFit();
+
+private:
+	struct Name {
+		uint32_t offset;   // Start of the name in `text`
+		uint32_t length;
+		uint32_t position; // Position of the item the name belongs to
+	};
+
+	struct Slot {
+		uint32_t hash; // Hash of a name with some characters deleted
+		uint32_t head; // Latest link of the names indexed under hash, NO_LINK if the slot is unused
+	};
+
+	struct Link {
+		uint32_t name; // Index into names
+		uint32_t next; // Earlier link under the same hash, or NO_LINK
+	};
+
+	std::string text;        // Every name, each followed by a null character
+	std::vector<Name> names;
+	std::vector<Slot> slots; // Open-addressing hash table, one slot per distinct hash
+	std::vector<Link> links; // The names under each hash, newest first
+	size_t used;
+
+	struct Lookup; // State of one suggest() call
+
+	// Index every deletion of up to `deletions` characters from s under name; `from` is the
+	// first position that may be deleted, so each combination is visited once.
+	void insertDeletions(const char* s, size_t length, size_t from, size_t deletions, uint32_t name);
+	void insertLink(uint32_t hash, uint32_t name);
+	void rebuild(size_t size);
+
+	// Look up every deletion of s in the same way and check the names found against the token.
+	void findDeletions(const char* s, size_t length, size_t from, size_t deletions, Lookup& lookup) const;
+};
+
+#endif
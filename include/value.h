@@ -4,13 +4,18 @@
 
 #include <string>
 #include <vector>
+#include <iosfwd>
 #include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
 
 #define LIST_SEPARATOR ", "
+#define LIST_MAX_DEPTH 8 // Deepest nesting of lists a value may have
 #define BOOL_TRUE "true"
 #define BOOL_FALSE "false"
+#define VALUE_INLINE_CAPACITY 12 // Strings shorter than this are stored inside the Value
 
-// TODO: Fix intepreting args like: "123" as numbers
 // TODO: Add support for VAL_ANY
 enum ValueType {
 	VAL_NONE,
@@ -21,74 +26,140 @@ enum ValueType {
 	VAL_LIST
 };
 
+class Value;
+class Arena;
+
+// Name of a type as shown in help: "int", "double", "bool", "string", "list" or "unknown".
+const char* valueTypeName(ValueType type);
+
+// Who owns a Value's string or list memory.
+enum ValueStorage {
+	STORAGE_HEAP,    // Owned and freed by the value
+	STORAGE_ARENA,   // Allocated from an Arena and released when the arena is reset
+	STORAGE_BORROWED // Belongs to another value that outlives this one
+};
+
+// String payload of a Value. Short strings live inline, longer ones on the heap, in which
+// case the first bytes of inlineData hold the heap pointer (kept as bytes so the struct
+// stays 16 bytes on 64-bit targets).
+// It converts to std::string so callbacks written against the old layout keep working.
+struct ValueString {
+	char inlineData[VALUE_INLINE_CAPACITY];
+	uint32_t length;
+
+	bool isInline() const { return length < VALUE_INLINE_CAPACITY; }
+	char* heapData() const {
+		char* p;
+		std::memcpy(&p, inlineData, sizeof(p));
+		return p;
+	}
+	void setHeapData(char* p) { std::memcpy(inlineData, &p, sizeof(p)); }
+	const char* c_str() const { return isInline() ? inlineData : heapData(); }
+	const char* data() const { return c_str(); }
+	size_t size() const { return length; }
+	bool empty() const { return length == 0; }
+	std::string str() const { return std::string(c_str(), length); }
+	operator std::string() const { return str(); }
+
+	bool operator==(const char* s) const;
+	bool operator==(const std::string& s) const;
+	bool operator!=(const char* s) const { return !(*this == s); }
+	bool operator!=(const std::string& s) const { return !(*this == s); }
+};
+
+// List payload of a Value; the elements are owned by the enclosing Value.
+struct ValueList {
+	Value* items;
+	uint32_t capacity;
+	uint32_t count;
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	const Value& operator[](size_t i) const;
+	Value& operator[](size_t i);
+	const Value* begin() const { return items; }
+	const Value* end() const;
+	operator std::vector<Value>() const;
+};
+
 class Value {
 public:
+	// Only the member matching `type` is meaningful. Scalars zero the rest of the payload,
+	// so reading stringValue or listValue of a scalar yields an empty string or list.
+	union {
+		int         intValue;
+		double      doubleValue;
+		bool        boolValue;
+		ValueString stringValue;
+		ValueList   listValue;
+	};
 	ValueType type;
-	int         intValue;
-	double      doubleValue;
-	bool        boolValue;
-	std::string stringValue;
-	std::vector<Value> listValue;
-
-	Value()
-		: type(VAL_NONE), intValue(0), doubleValue(0.0), boolValue(false) {
-	}
 
-	Value(int v)
-		: type(VAL_INT), intValue(v), doubleValue(0.0), boolValue(false) {
-	}
+	Value() : type(VAL_NONE), storage(STORAGE_HEAP) { clearPayload(); }
+	Value(int v) : type(VAL_INT), storage(STORAGE_HEAP) { clearPayload(); intValue = v; }
+	Value(double v) : type(VAL_DOUBLE), storage(STORAGE_HEAP) { clearPayload(); doubleValue = v; }
+	Value(bool v) : type(VAL_BOOL), storage(STORAGE_HEAP) { clearPayload(); boolValue = v; }
+	Value(const std::string& v) : type(VAL_STRING), storage(STORAGE_HEAP) { assignString(v.data(), v.size(), 0); }
+	Value(const char* v);
+	// A string allocated from arena if given; VAL_NONE instead if a fixed arena has no room for it.
+	Value(const char* v, size_t length, Arena* arena = 0) : type(VAL_STRING), storage(STORAGE_HEAP) { assignString(v, length, arena); }
+	Value(const std::vector<Value>& v);
 
-	Value(double v)
-		: type(VAL_DOUBLE), intValue(0), doubleValue(v), boolValue(false) {
-	}
+	Value(const Value& other);
+	Value(Value&& other) noexcept;
+	Value& operator=(const Value& other);
+	Value& operator=(Value&& other) noexcept;
+	~Value() { release(); }
 
-	Value(bool v)
-		: type(VAL_BOOL), intValue(0), doubleValue(0.0), boolValue(v) {
-	}
+	// Create an empty list with room for `capacity` elements, allocated from arena if given.
+	// The result is VAL_NONE if a fixed arena has no room for them.
+	static Value list(size_t capacity = 0, Arena* arena = 0);
 
-	Value(const std::string& v)
-		: type(VAL_STRING), intValue(0), doubleValue(0.0), boolValue(false), stringValue(v) {
-	}
+	// Return a value that shares other's payload without owning it; other must outlive it.
+	// Copies of the result are deep, so it is safe to hand to callbacks.
+	static Value borrow(const Value& other);
 
-	Value(const char* v)
-		: type(VAL_STRING), intValue(0), doubleValue(0.0), boolValue(false), stringValue(v) {
-	}
+	// Return a string value that points at s without copying it, e.g. a literal in a command
+	// table; s must be terminated and outlive the value. Short strings are copied inline.
+	static Value borrowString(const char* s, size_t length);
 
-	Value(const std::vector<Value>& v)
-		: type(VAL_LIST), intValue(0), doubleValue(0.0), boolValue(false), listValue(v) {
-	}
+	// Append an element to a list value, growing it in arena if given. Returns false, leaving the
+	// list unchanged, if the value is not a list or a fixed arena has no room to grow it.
+	bool append(const Value& item);
+	bool append(Value&& item, Arena* arena = 0);
 
-	std::string toString() const {
-		char buffer[32];
-		switch (type) {
-		case VAL_INT:
-			std::sprintf(buffer, "%d", intValue);
-			return std::string(buffer);
-		case VAL_DOUBLE:
-			std::sprintf(buffer, "%f", doubleValue);
-			return std::string(buffer);
-		case VAL_BOOL:
-			return boolValue ? BOOL_TRUE : BOOL_FALSE;
-		case VAL_STRING:
-			return stringValue;
-		case VAL_LIST: {
-			std::string result = "[";
-			for (size_t i = 0; i < listValue.size(); i++) {
-				result += listValue[i].toString();
-				if (i < listValue.size() - 1)
-					result += LIST_SEPARATOR;
-			}
-			result += "]";
-			return result;
-		}
-		default:
-			return "";
-		}
-	}
+	ValueStorage getStorage() const { return (ValueStorage)storage; }
+
+	std::string toString() const;
 
 	const char* toCString() const {
 		return toString().c_str();
 	}
+
+private:
+	unsigned char storage; // ValueStorage of the string or list payload; sits in padding after type
+
+	void clearPayload();
+	bool assignString(const char* s, size_t length, Arena* arena);
+	bool reserveList(size_t capacity, Arena* arena);
+	void copyFrom(const Value& other);
+	void moveFrom(Value& other);
+	void release();
 };
 
+inline const Value& ValueList::operator[](size_t i) const { return items[i]; }
+inline Value& ValueList::operator[](size_t i) { return items[i]; }
+inline const Value* ValueList::end() const { return items + count; }
+
+// Concatenation helpers, since std::string's operator+ cannot deduce through the conversion.
+std::string operator+(const std::string& lhs, const ValueString& rhs);
+std::string operator+(const char* lhs, const ValueString& rhs);
+std::string operator+(const ValueString& lhs, const std::string& rhs);
+std::string operator+(const ValueString& lhs, const char* rhs);
+
+template <class CharT, class Traits>
+std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const ValueString& s) {
+	return os << s.c_str();
+}
+
 #endif
@@ -0,0 +1,94 @@
+// include/wire_format.h
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <stdint.h>
+#include <cstddef>
+#include "value.h"
+#include "arena.h"
+
+// Binary command encoding for links where every byte counts. A frame holds one or more commands
+// already resolved against a frozen command tree, so the receiver neither lexes nor matches names:
+//
+//	frame    := WIRE_VERSION command*
+//	command  := varint(id) varint(argCount) argument*
+//	argument := varint(slot << 1 | many) [varint(valueCount) if many] value*
+//	value    := WIRE_NONE | WIRE_FALSE | WIRE_TRUE
+//	          | WIRE_INT zigzag-varint
+//	          | WIRE_DOUBLE 8 bytes, IEEE 754 little-endian
+//	          | WIRE_FLOAT 4 bytes, IEEE 754 little-endian
+//	          | WIRE_STRING varint(length) bytes
+//	          | WIRE_LIST varint(count) value*
+//	          | WIRE_INT_LIST varint(count) zigzag-varint*
+//
+// ids are assigned by Dispatcher::freeze() (see Command::id) and slots are argument spec slots,
+// so both ends must register the same tree. An argument with exactly one value, the common case,
+// has no valueCount. Lists of ints are packed without a tag per element, and doubles that a float
+// holds exactly, such as 2.5, are sent in 4 bytes.
+
+#define WIRE_VERSION 1
+#define WIRE_NO_ID 0xFFFFFFFFu // Id of a command that is not part of a frozen tree
+#define WIRE_MAX_VARINT_BYTES 5
+#define WIRE_MAX_DEPTH LIST_MAX_DEPTH // Deepest list nesting a decoded value may have
+
+enum WireTag {
+	WIRE_NONE,
+	WIRE_FALSE,
+	WIRE_TRUE,
+	WIRE_INT,
+	WIRE_DOUBLE,
+	WIRE_STRING,
+	WIRE_LIST,
+	WIRE_INT_LIST,
+	WIRE_FLOAT
+};
+
+// Writes a frame into a fixed buffer. Running out of room is sticky: later writes are dropped
+// and ok() returns false, so callers check once at the end.
+class WireWriter {
+public:
+	WireWriter(uint8_t* out, size_t size);
+
+	// Start the frame; call once before the first command.
+	void beginFrame() { byte(WIRE_VERSION); }
+
+	void beginCommand(uint32_t id, size_t argCount);
+	void beginArgument(size_t slot, size_t valueCount);
+	void value(const Value& v);
+
+	void byte(uint8_t b);
+	void varint(uint32_t v);
+	void bytes(const void* data, size_t length);
+
+	bool ok() const { return !overflow; }
+	size_t size() const { return length; }
+
+private:
+	uint8_t* buffer;
+	size_t capacity;
+	size_t length;
+	bool overflow;
+};
+
+// Reads the primitives of a frame. Every read returns false on truncated or malformed input.
+class WireReader {
+public:
+	WireReader(const uint8_t* input, size_t size) : data(input), length(size), position(0) {}
+
+	bool byte(uint8_t& out);
+	bool varint(uint32_t& out);
+
+	// Decode a value, allocating strings and lists from arena; depth bounds list nesting.
+	// Also fails if a fixed arena runs out, which the arena's hasOverflowed() tells apart.
+	bool value(Value& out, Arena* arena, unsigned depth = 0);
+
+	bool atEnd() const { return position == length; }
+	size_t getPosition() const { return position; }
+
+private:
+	const uint8_t* data;
+	size_t length;
+	size_t position;
+};
+
+#endif
@@ -0,0 +1,110 @@
+// src/arena.cpp
+#include "arena.h"
+#include <stdint.h>
+
+Arena::Arena(size_t blockSize)
+	: blocks(0), cursor(0), limit(0), blockSize(blockSize), used(0), peak(0), fixed(false), overflowed(false) {
+}
+
+Arena::Arena(void* buffer, size_t size)
+	: blocks(0), cursor(0), limit(0), blockSize(ARENA_DEFAULT_BLOCK_SIZE), used(0), peak(0), fixed(false), overflowed(false) {
+	setBuffer(buffer, size);
+}
+
+Arena::~Arena() {
+	releaseBlocks();
+}
+
+void Arena::releaseBlocks() {
+	if (!fixed) {
+		while (blocks) {
+			Block* next = blocks->next;
+			::operator delete(blocks);
+			blocks = next;
+		}
+	}
+	blocks = 0;
+	cursor = 0;
+	limit = 0;
+}
+
+void Arena::setBuffer(void* buffer, size_t size) {
+	releaseBlocks();
+	fixed = buffer != 0;
+	if (fixed) {
+		cursor = static_cast<char*>(buffer);
+		limit = cursor + size;
+	}
+	used = 0;
+	overflowed = false;
+}
+
+bool Arena::addBlock(size_t minimum) {
+	size_t size = blockSize > minimum ? blockSize : minimum;
+	Block* block = static_cast<Block*>(::operator new(sizeof(Block) + size));
+	block->next = blocks;
+	block->size = size;
+	blocks = block;
+	cursor = block->data();
+	limit = cursor + size;
+	return true;
+}
+
+// Bytes needed to align the cursor to alignment.
+size_t Arena::padding(size_t alignment) const {
+	uintptr_t address = reinterpret_cast<uintptr_t>(cursor);
+	return (alignment - (address & (alignment - 1))) & (alignment - 1);
+}
+
+bool Arena::canAllocate(size_t size, size_t alignment) {
+	if (!fixed || (cursor && padding(alignment) + size <= (size_t)(limit - cursor)))
+		return true;
+	overflowed = true;
+	return false;
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+	size_t pad = padding(alignment);
+	if (!cursor || pad + size > (size_t)(limit - cursor)) {
+		if (fixed) {
+			overflowed = true;
+			return 0;
+		}
+		addBlock(size + alignment);
+		pad = padding(alignment);
+	}
+	char* result = cursor + pad;
+	cursor = result + size;
+	used += pad + size;
+	if (used > peak)
+		peak = used;
+	return result;
+}
+
+void Arena::reset() {
+	if (fixed) {
+		cursor -= used;
+	}
+	else if (blocks && blocks->next) {
+		// The last cycle needed more than one block; replace them with a single block that fits the peak.
+		releaseBlocks();
+		if (blockSize < peak)
+			blockSize = peak;
+		addBlock(blockSize);
+	}
+	else if (blocks) {
+		cursor = blocks->data();
+		limit = cursor + blocks->size;
+	}
+	used = 0;
+	overflowed = false;
+}
+
+size_t Arena::getCapacity() const {
+	if (fixed)
+		return (size_t)(limit - cursor) + used;
+	size_t total = 0;
+	for (Block* b = blocks; b; b = b->next)
+		total += b->size;
+	return total;
+}
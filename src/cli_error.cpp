@@ -0,0 +1,268 @@
+// src/cli_error.cpp
+#include "cli_error.h"
+#include "RaptorCLI.h"
+#include <cstdio>
+#include <cstring>
+
+const char* cliErrorCode(CLIErrorCode code) {
+	switch (code) {
+	case CLI_ERROR_UNKNOWN_COMMAND: return ERROR_CMD_UNKNOWN;
+	case CLI_ERROR_UNKNOWN_COMMAND_ID: return ERROR_CMD_UNKNOWN;
+	case CLI_ERROR_UNEXPECTED_TOKEN: return ERROR_CMD_UNEXPECTED_TOKEN;
+	case CLI_ERROR_UNKNOWN_ARG: return ERROR_CMD_UNKNOWN_ARG;
+	case CLI_ERROR_DUPLICATE_ARG: return ERROR_CMD_DUPLICATE_NAME;
+	case CLI_ERROR_DUPLICATE_HELP_FLAG: return ERROR_CMD_DUPLICATE_HELP_FLAG;
+	case CLI_ERROR_MISSING_VALUE: return ERROR_CMD_MISSING_REQUIRED_ARG;
+	case CLI_ERROR_MISSING_REQUIRED_ARG: return ERROR_CMD_MISSING_REQUIRED_ARG;
+	case CLI_ERROR_TYPE_MISMATCH: return ERROR_CMD_TYPE_MISMATCH;
+	case CLI_ERROR_NO_CALLBACK: return ERROR_CMD_NO_CALLBACK;
+	case CLI_ERROR_OUT_OF_MEMORY: return ERROR_CMD_OUT_OF_MEMORY;
+	case CLI_ERROR_INPUT_TOO_LONG: return ERROR_CMD_INPUT_TOO_LONG;
+	case CLI_ERROR_FRAME_VERSION: return ERROR_CMD_MALFORMED_FRAME;
+	case CLI_ERROR_MALFORMED_FRAME: return ERROR_CMD_MALFORMED_FRAME;
+	case CLI_ERROR_FROZEN: return ERROR_CMD_FROZEN;
+	case CLI_ERROR_DUPLICATE_NAME: return ERROR_CMD_DUPLICATE_NAME;
+	case CLI_ERROR_DUPLICATE_ALIAS: return ERROR_CMD_DUPLICATE_ALIAS;
+	case CLI_ERROR_DUPLICATE_SUBCOMMAND: return ERROR_CMD_DUPLICATE_NAME;
+	case CLI_ERROR_DUPLICATE_SUBCOMMAND_ALIAS: return ERROR_CMD_DUPLICATE_ALIAS;
+	case CLI_ERROR_ALIAS_IS_NAME: return ERROR_CMD_DUPLICATE_ALIAS;
+	case CLI_ERROR_REPEATED_ALIAS: return ERROR_CMD_DUPLICATE_ALIAS;
+	case CLI_ERROR_DUPLICATE_ARG_NAME: return ERROR_CMD_DUPLICATE_NAME;
+	case CLI_ERROR_TOO_MANY_ARGS: return ERROR_CMD_TOO_MANY_ARGS;
+	default: return "";
+	}
+}
+
+CLIError::CLIError(CLIErrorCode errorCode)
+	: code(errorCode), tokenIndex(CLI_ERROR_NO_POSITION), offset(CLI_ERROR_NO_POSITION), command(0), tableCommand(0),
+	argSpec(0), tableArgSpec(0), name(0), commandId(0), suggestions(0) {
+}
+
+void CLIError::setToken(const TokenList& tokens, size_t index, const char* input) {
+	if (index >= tokens.size())
+		return;
+	tokenIndex = index;
+	token = tokens[index];
+	const char* base = input ? input : tokens[0].data;
+	if (base && token.data >= base)
+		offset = (size_t)(token.data - base);
+}
+
+const char* CLIError::commandName() const {
+	if (command)
+		return command->name.c_str();
+	if (tableCommand)
+		return tableCommand->name.text;
+	return "";
+}
+
+const char* CLIError::argumentName() const {
+	if (argSpec)
+		return argSpec->name.c_str();
+	if (tableArgSpec)
+		return tableArgSpec->name.text;
+	return "";
+}
+
+// Receives rendered text: either a buffer, which is cut short when full, or an output.
+struct ErrorText {
+	char* buffer;
+	size_t size;
+	size_t length;
+	CLIOutput* out;
+
+	void put(const char* text, size_t n) {
+		if (out) {
+			out->write(text, n);
+			return;
+		}
+		if (length + 1 >= size)
+			return;
+		if (n > size - 1 - length)
+			n = size - 1 - length;
+		std::memcpy(buffer + length, text, n);
+		length += n;
+		buffer[length] = '\0';
+	}
+
+	void put(const char* text) { put(text, std::strlen(text)); }
+
+	void putNumber(unsigned long n) {
+		char digits[24];
+		put(digits, (size_t)std::sprintf(digits, "%lu", n));
+	}
+
+	// Write the token's text with quotes and escapes resolved, as Token::str() returns it.
+	void putToken(const Token& token, size_t skip = 0) {
+		if (!token.data)
+			return;
+		Token text = skip > token.length ? Token() : Token(token.data + skip, token.length - skip, token.flags);
+		if (!text.isQuoted()) {
+			Token trimmed = Lexer::trim(text);
+			put(trimmed.data, trimmed.length);
+			return;
+		}
+		char resolved[CLI_ERROR_TOKEN_MAX];
+		if (text.length <= sizeof(resolved))
+			put(resolved, text.unquoteTo(resolved));
+		else
+			put(text.data, text.length);
+	}
+
+	// ". Did you mean: a, b?" for the suggestions, each name after prefix.
+	void putSuggestions(const Suggestions* suggestions, const char* prefix) {
+		if (!suggestions)
+			return;
+		for (size_t i = 0; i < suggestions->count; i++) {
+			put(i == 0 ? ". Did you mean: " : ", ");
+			put(prefix);
+			put(suggestions->names[i]);
+		}
+		if (suggestions->count > 0)
+			put("?");
+	}
+};
+
+// The texts are the ones the dispatcher reported before errors were structured.
+static void describe(const CLIError& error, ErrorText& text) {
+	switch (error.code) {
+	case CLI_ERROR_UNKNOWN_COMMAND:
+		text.put("Unknown command: ");
+		text.putToken(error.token);
+		text.putSuggestions(error.suggestions, "");
+		break;
+	case CLI_ERROR_UNKNOWN_COMMAND_ID:
+		text.put("Unknown command id: ");
+		text.putNumber(error.commandId);
+		break;
+	case CLI_ERROR_UNEXPECTED_TOKEN:
+		text.put("Unexpected token: ");
+		text.putToken(error.token);
+		text.putSuggestions(error.suggestions, "");
+		break;
+	case CLI_ERROR_UNKNOWN_ARG:
+		text.put("Unknown argument: ");
+		text.putToken(error.token, 1);
+		text.putSuggestions(error.suggestions, "-");
+		break;
+	case CLI_ERROR_DUPLICATE_ARG:
+		text.put("Duplicate argument: ");
+		if (error.token.data)
+			text.putToken(error.token, 1);
+		else
+			text.put(error.argumentName());
+		break;
+	case CLI_ERROR_DUPLICATE_HELP_FLAG:
+		text.put("Duplicate help flag: both -h and -help provided.");
+		break;
+	case CLI_ERROR_MISSING_VALUE:
+		text.put("Argument ");
+		text.put(error.argumentName());
+		text.put(" has no value.");
+		break;
+	case CLI_ERROR_MISSING_REQUIRED_ARG:
+		text.put("Required argument missing: ");
+		text.put(error.argumentName());
+		break;
+	case CLI_ERROR_TYPE_MISMATCH:
+		text.put("Type mismatch for argument: ");
+		text.put(error.argumentName());
+		if (error.token.data) {
+			text.put(" (");
+			text.putToken(error.token);
+			text.put(")");
+		}
+		break;
+	case CLI_ERROR_NO_CALLBACK:
+		text.put("No callback defined for command: ");
+		text.put(error.commandName());
+		break;
+	case CLI_ERROR_OUT_OF_MEMORY:
+		text.put("Out of memory: command does not fit in the dispatch arena.");
+		break;
+	case CLI_ERROR_INPUT_TOO_LONG:
+		text.put("Input too long: command exceeds the stream buffer.");
+		break;
+	case CLI_ERROR_FRAME_VERSION:
+		text.put("Malformed frame: missing or unsupported version.");
+		break;
+	case CLI_ERROR_MALFORMED_FRAME:
+		text.put("Malformed frame at byte ");
+		text.putNumber((unsigned long)error.offset);
+		if (error.command || error.tableCommand) {
+			text.put(" in command: ");
+			text.put(error.commandName());
+		}
+		break;
+	case CLI_ERROR_FROZEN:
+		text.put("Cannot register command after freeze(): ");
+		text.put(error.commandName());
+		break;
+	case CLI_ERROR_DUPLICATE_NAME:
+		text.put("Duplicate command name: ");
+		text.put(error.name ? error.name : error.commandName());
+		break;
+	case CLI_ERROR_DUPLICATE_ALIAS:
+		text.put("Duplicate command alias: ");
+		text.put(error.name ? error.name : "");
+		break;
+	case CLI_ERROR_DUPLICATE_SUBCOMMAND:
+		text.put("Duplicate subcommand name: ");
+		text.put(error.name ? error.name : "");
+		break;
+	case CLI_ERROR_DUPLICATE_SUBCOMMAND_ALIAS:
+		text.put("Duplicate subcommand alias: ");
+		text.put(error.name ? error.name : "");
+		break;
+	case CLI_ERROR_ALIAS_IS_NAME:
+		text.put("Alias cannot be the same as the command name: ");
+		text.put(error.name ? error.name : "");
+		break;
+	case CLI_ERROR_REPEATED_ALIAS:
+		text.put("Duplicate alias: ");
+		text.put(error.name ? error.name : "");
+		break;
+	case CLI_ERROR_DUPLICATE_ARG_NAME:
+		text.put("Duplicate argument name: ");
+		text.put(error.argumentName());
+		break;
+	case CLI_ERROR_TOO_MANY_ARGS:
+		text.put("Too many arguments for command: ");
+		text.put(error.commandName());
+		break;
+	default:
+		break;
+	}
+}
+
+size_t CLIError::render(char* buffer, size_t size) const {
+	if (size == 0)
+		return 0;
+	buffer[0] = '\0';
+	ErrorText text = { buffer, size, 0, 0 };
+	describe(*this, text);
+	return text.length;
+}
+
+void CLIError::print(CLIOutput* out) const {
+	if (!out)
+		return;
+	ErrorText text = { 0, 0, 0, out };
+	describe(*this, text);
+}
+
+// Collects printed text into a string.
+struct StringCLIOutput : CLIOutput {
+	std::string text;
+
+	void print(const std::string& s) override { text += s; }
+	void println(const std::string& s) override { text += s; }
+	void println() override {}
+	void write(const char* data, size_t length) override { text.append(data, length); }
+};
+
+std::string CLIError::text() const {
+	StringCLIOutput out;
+	print(&out);
+	return out.text;
+}
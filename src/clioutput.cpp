@@ -0,0 +1,103 @@
+// src/clioutput.cpp
+#include "clioutput.h"
+#include <cstring>
+#if !defined(ARDUINO) && (defined(__unix__) || defined(__APPLE__))
+#define CLI_OUTPUT_POSIX 1
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+#ifndef ARDUINO
+#include <cstdio>
+#endif
+
+BufferedCLIOutput::BufferedCLIOutput(size_t size)
+	: buffer(new char[size ? size : 1]), capacity(size ? size : 1), used(0), ownsBuffer(true) {
+}
+
+BufferedCLIOutput::BufferedCLIOutput(char* storage, size_t size)
+	: buffer(storage), capacity(size), used(0), ownsBuffer(false) {
+}
+
+BufferedCLIOutput::~BufferedCLIOutput() {
+	flush();
+	if (ownsBuffer)
+		delete[] buffer;
+}
+
+void BufferedCLIOutput::println(const std::string& s) {
+	write(s.data(), s.size());
+	write("\n", 1);
+}
+
+void BufferedCLIOutput::write(const char* data, size_t length) {
+	if (length <= capacity - used) {
+		std::memcpy(buffer + used, data, length);
+		used += length;
+		return;
+	}
+	// Top up the buffer first; if the rest still does not fit, write both parts at once.
+	size_t head = capacity - used;
+	std::memcpy(buffer + used, data, head);
+	used = capacity;
+	data += head;
+	length -= head;
+	if (length < capacity) {
+		sink(buffer, used, 0, 0);
+		std::memcpy(buffer, data, length);
+		used = length;
+		return;
+	}
+	sink(buffer, used, data, length);
+	used = 0;
+}
+
+void BufferedCLIOutput::flush() {
+	if (used == 0)
+		return;
+	sink(buffer, used, 0, 0);
+	used = 0;
+}
+
+void BufferedCLIOutput::sink(const char* first, size_t firstLength, const char* second, size_t secondLength) {
+#if defined(ARDUINO)
+	Serial.write(reinterpret_cast<const uint8_t*>(first), firstLength);
+	if (secondLength)
+		Serial.write(reinterpret_cast<const uint8_t*>(second), secondLength);
+#elif defined(CLI_OUTPUT_POSIX)
+	// Whatever went through iostreams or stdio so far must come out first.
+	std::cout.flush();
+	std::fflush(stdout);
+	struct iovec parts[2];
+	parts[0].iov_base = const_cast<char*>(first);
+	parts[0].iov_len = firstLength;
+	parts[1].iov_base = const_cast<char*>(second);
+	parts[1].iov_len = secondLength;
+	struct iovec* next = parts;
+	int count = secondLength ? 2 : 1;
+	while (count > 0) {
+		ssize_t written = ::writev(STDOUT_FILENO, next, count);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		// Skip what a partial write already covered.
+		size_t done = (size_t)written;
+		while (count > 0 && done >= next->iov_len) {
+			done -= next->iov_len;
+			next++;
+			count--;
+		}
+		if (count > 0) {
+			next->iov_base = static_cast<char*>(next->iov_base) + done;
+			next->iov_len -= done;
+		}
+	}
+#else
+	std::fwrite(first, 1, firstLength, stdout);
+	if (secondLength)
+		std::fwrite(second, 1, secondLength, stdout);
+	std::fflush(stdout);
+#endif
+}
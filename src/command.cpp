@@ -1,138 +1,224 @@
 // src/command.cpp
 #include "command.h"
 #include "clioutput.h"
-#include "dispatcher.h"
 #include "RaptorCLI.h"
 #include <string>
+#include <utility>
 
-extern Dispatcher dispatcher;
+static CommandErrorCallback gErrorCallback = 0;
+static CommandErrorHandler gErrorHandler = 0;
 
-Command::Command() : name(""), callback(0), output(nullptr), variadic(false) {}
+void Command::registerErrorCallback(CommandErrorCallback callback) {
+	gErrorCallback = callback;
+}
 
-Command::Command(const std::string& cmdName, const std::string& desc, CLIOutput* output, CommandCallback cb)
-	: name(cmdName), description(desc), callback(cb), output(output), variadic(false) {
+void Command::registerErrorHandler(CommandErrorHandler handler) {
+	gErrorHandler = handler;
 }
 
-bool Command::addSubcommand(const Command& cmd) {
-	for (size_t i = 0; i < subcommands.size(); i++) {
-		if (subcommands[i].name == cmd.name) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-			dispatcher.reportError("Duplicate subcommand name: " + cmd.name);
-#else
-			dispatcher.reportError(ERROR_CMD_DUPLICATE_NAME);
-#endif
-			return false;
-		}
-		for (size_t j = 0; j < cmd.aliases.size(); j++) {
-			if (subcommands[i].name == cmd.aliases[j]) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-				dispatcher.reportError("Duplicate subcommand alias: " + cmd.aliases[j]);
-#else
-				dispatcher.reportError(ERROR_CMD_DUPLICATE_ALIAS);
-#endif
-				return false;
-			}
-			for (size_t k = 0; k < subcommands[i].aliases.size(); k++) {
-				if (subcommands[i].aliases[k] == cmd.aliases[j]) {
+// The callback gets the same text or code as before errors were structured; the text is only
+// built when there is a callback to take it.
+void Command::reportError(const CLIError& error) {
+	if (gErrorHandler) {
+		gErrorHandler(error);
+		return;
+	}
+	if (!gErrorCallback)
+		return;
 #ifdef USE_DESCRIPTIVE_ERRORS
-					dispatcher.reportError("Duplicate subcommand alias: " + cmd.aliases[j]);
+	gErrorCallback(error.text());
 #else
-					dispatcher.reportError(ERROR_CMD_DUPLICATE_ALIAS);
+	gErrorCallback(error.codeString());
 #endif
-					return false;
-				}
-			}
-		}
-	}
+}
+
+Command::Command() : name(""), variadic(false), id(WIRE_NO_ID), callback(0), invocationCallback(0), output(nullptr), usageRendered(false) {}
+
+Command::Command(const std::string& cmdName, const std::string& desc, CLIOutput* output, CommandCallback cb)
+	: name(cmdName), description(desc), variadic(false), id(WIRE_NO_ID), callback(cb), invocationCallback(0), output(output), usageRendered(false) {
+}
+
+// Names and aliases are looked up in the subcommand index, so the check does not grow with the number of siblings.
+bool Command::canAddSubcommand(const Command& cmd) const {
+	const std::string* clash = subcommandIndex.findClash(subcommands, cmd);
+	if (!clash)
+		return true;
+	CLIError error(clash == &cmd.name ? CLI_ERROR_DUPLICATE_SUBCOMMAND : CLI_ERROR_DUPLICATE_SUBCOMMAND_ALIAS);
+	error.command = this;
+	error.name = clash->c_str();
+	reportError(error);
+	return false;
+}
+
+bool Command::addSubcommand(const Command& cmd) {
+	if (!canAddSubcommand(cmd))
+		return false;
 	subcommands.push_back(cmd);
+	subcommandIndex.insert(subcommands, subcommands.size() - 1);
+	usageRendered = false;
 	return true;
 }
 
-bool Command::addAlias(const std::string& alias) {
-	if (alias == name) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-		dispatcher.reportError("Alias cannot be the same as the command name: " + alias);
-#else
-		dispatcher.reportError(ERROR_CMD_DUPLICATE_ALIAS);
-#endif
+bool Command::addSubcommand(Command&& cmd) {
+	if (!canAddSubcommand(cmd))
 		return false;
+	subcommands.push_back(std::move(cmd));
+	subcommandIndex.insert(subcommands, subcommands.size() - 1);
+	usageRendered = false;
+	return true;
+}
+
+void Command::shrinkToFit() {
+	aliases.shrink_to_fit();
+	argSpecs.shrink_to_fit();
+	subcommands.shrink_to_fit();
+	for (size_t i = 0; i < subcommands.size(); i++) {
+		subcommands[i].shrinkToFit();
 	}
-	for (size_t i = 0; i < aliases.size(); i++) {
-		if (aliases[i] == alias) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-			dispatcher.reportError("Duplicate alias: " + alias);
-#else
-			dispatcher.reportError(ERROR_CMD_DUPLICATE_ALIAS);
+	subcommandIndex.shrinkToFit();
+	argIndex.shrinkToFit();
+}
+
+const Command* Command::findSubcommand(const char* token, size_t length) const {
+	int position = subcommandIndex.find(subcommands, token, length);
+	return position < 0 ? 0 : &subcommands[position];
+}
+
+#ifdef USE_SUGGESTIONS
+void Command::suggestSubcommands(const char* token, size_t length, Suggestions& out) const {
+	subcommandIndex.suggest(token, length, out);
+}
+
+void Command::suggestArguments(const char* token, size_t length, Suggestions& out) const {
+	argIndex.suggest(token, length, out);
+}
 #endif
-			return false;
+
+bool Command::invoke(ArgumentList& args, CLIOutput* out, const int* slotPositions, Dispatcher* dispatcher) const {
+	if (invocationCallback) {
+		Invocation invocation(*this, args, out ? out : output, slotPositions, dispatcher);
+		invocationCallback(invocation);
+		return true;
+	}
+	if (callback) {
+		// Swap rather than copy, and swap back afterwards so nested calls restore their own arguments.
+		arguments.swap(args);
+		callback(*this);
+		arguments.swap(args);
+		return true;
+	}
+	return false;
+}
+
+bool Command::addAlias(const std::string& alias) {
+	CLIError error(CLI_ERROR_NONE);
+	if (alias == name) {
+		error.code = CLI_ERROR_ALIAS_IS_NAME;
+	}
+	else {
+		for (size_t i = 0; i < aliases.size(); i++) {
+			if (aliases[i] == alias)
+				error.code = CLI_ERROR_REPEATED_ALIAS;
 		}
 	}
+	if (error.code != CLI_ERROR_NONE) {
+		error.command = this;
+		error.name = alias.c_str();
+		reportError(error);
+		return false;
+	}
 	aliases.push_back(alias);
+	usageRendered = false;
 	return true;
 }
 
 bool Command::addArgSpec(const ArgSpec& spec) {
-	for (size_t i = 0; i < argSpecs.size(); i++) {
-		if (argSpecs[i].name == spec.name) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-			dispatcher.reportError("Duplicate argument name: " + spec.name);
-#else
-			dispatcher.reportError(ERROR_CMD_DUPLICATE_NAME);
-#endif
-			return false;
-		}
+	CLIError error(CLI_ERROR_NONE);
+	if (argIndex.find(argSpecs, spec.name.data(), spec.name.size()) >= 0)
+		error.code = CLI_ERROR_DUPLICATE_ARG_NAME;
+	else if (argSpecs.size() >= MAX_ARG_SPECS)
+		error.code = CLI_ERROR_TOO_MANY_ARGS;
+	if (error.code != CLI_ERROR_NONE) {
+		error.command = this;
+		error.argSpec = &spec;
+		reportError(error);
+		return false;
 	}
 	argSpecs.push_back(spec);
+	argSpecs.back().slot = (int)(argSpecs.size() - 1);
+	argIndex.insert(argSpecs, argSpecs.size() - 1);
+	usageRendered = false;
 	return true;
 }
 
+int Command::argSlot(const std::string& name) const {
+	return argIndex.find(argSpecs, name.data(), name.size());
+}
+
+int Command::argSlot(const char* token, size_t length) const {
+	return argIndex.find(argSpecs, token, length);
+}
+
 void Command::printUsage(const std::string& prefix, CLIOutput* out) const {
 	CLIOutput* outPtr = out ? out : (output ? output : nullptr);
 	if (!outPtr) {
+#ifdef ARDUINO
 		Serial.println((prefix + name + " - " + description).c_str());
+#else
+		std::cout << prefix << name << " - " << description << std::endl;
+#endif
+		return;
 	}
-	else {
-		std::string cmdLine = prefix + name;
+	HelpWriter writer(outPtr);
+	writer.setPrefix(prefix.data(), prefix.size());
+	writeUsage(writer);
+}
+
+void Command::renderUsage() const {
+	if (!usageRendered) {
+		std::string text = name;
 		if (!aliases.empty()) {
-			cmdLine += " (aliases: ";
+			text += " (aliases: ";
 			for (size_t i = 0; i < aliases.size(); i++) {
-				cmdLine += aliases[i];
+				text += aliases[i];
 				if (i < aliases.size() - 1) {
-					cmdLine += ", ";
+					text += ", ";
 				}
 			}
-			cmdLine += ")";
+			text += ")";
 		}
-		outPtr->println((cmdLine + " - " + description).c_str());
+		text += " - " + description + "\n";
 		if (!argSpecs.empty()) {
-			outPtr->println((prefix + "  Arguments:").c_str());
+			text += "  Arguments:\n";
 			for (size_t i = 0; i < argSpecs.size(); i++) {
-				std::string argLine = prefix + "    -" + argSpecs[i].name + " (";
-				switch (argSpecs[i].type) {
-				case VAL_INT: argLine += "int"; break;
-				case VAL_DOUBLE: argLine += "double"; break;
-				case VAL_BOOL: argLine += "bool"; break;
-				case VAL_STRING: argLine += "string"; break;
-				case VAL_LIST: argLine += "list"; break;
-				default: argLine += "unknown"; break;
-				}
-				argLine += ") ";
-				argLine += (argSpecs[i].required ? "required" : "optional");
+				text += "    -" + argSpecs[i].name + " (" + valueTypeName(argSpecs[i].type) + ") ";
+				text += (argSpecs[i].required ? "required" : "optional");
 				if (argSpecs[i].hasDefault) {
-					argLine += ", default = " + argSpecs[i].defaultValue.toString();
+					text += ", default = " + argSpecs[i].defaultValue.toString();
 				}
 				if (!argSpecs[i].helpText.empty()) {
-					argLine += " -- " + argSpecs[i].helpText;
+					text += " -- " + argSpecs[i].helpText;
 				}
-				outPtr->println(argLine.c_str());
+				text += "\n";
 			}
 		}
 		if (!subcommands.empty()) {
-			outPtr->println((prefix + "  Subcommands:").c_str());
-			for (size_t i = 0; i < subcommands.size(); i++) {
-				subcommands[i].printUsage(prefix + "    ", outPtr);
-			}
+			text += "  Subcommands:\n";
 		}
+		usageText.swap(text);
+		usageRendered = true;
+	}
+	for (size_t i = 0; i < subcommands.size(); i++) {
+		subcommands[i].renderUsage();
+	}
+}
+
+void Command::writeUsage(HelpWriter& writer, size_t indent) const {
+	if (!usageRendered)
+		renderUsage();
+	writer.block(indent, usageText.data(), usageText.size());
+	for (size_t i = 0; i < subcommands.size(); i++) {
+		subcommands[i].writeUsage(writer, indent + HELP_INDENT_STEP);
 	}
 }
 
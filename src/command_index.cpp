@@ -0,0 +1,149 @@
+// src/command_index.cpp
+#include "command_index.h"
+#include "command.h"
+#include <cstring>
+
+#define EMPTY_SLOT 0xFFFFFFFFu
+#define INITIAL_SLOTS 8
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+CommandIndex::CommandIndex() : used(0) {}
+
+uint32_t CommandIndex::hash(const char* s, size_t length) {
+	uint32_t h = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < length; i++) {
+		h ^= (unsigned char)s[i];
+		h *= FNV_PRIME;
+	}
+	return h;
+}
+
+void CommandIndex::insert(const std::vector<Command>& commands, size_t position) {
+	const Command& cmd = commands[position];
+	insertKey(hash(cmd.name.data(), cmd.name.size()), (uint32_t)position, -1);
+	for (size_t i = 0; i < cmd.aliases.size(); i++) {
+		insertKey(hash(cmd.aliases[i].data(), cmd.aliases[i].size()), (uint32_t)position, (int32_t)i);
+	}
+#ifdef USE_SUGGESTIONS
+	suggestions.insert(cmd.name.data(), cmd.name.size(), (uint32_t)position);
+	for (size_t i = 0; i < cmd.aliases.size(); i++) {
+		suggestions.insert(cmd.aliases[i].data(), cmd.aliases[i].size(), (uint32_t)position);
+	}
+#endif
+}
+
+void CommandIndex::insertKey(uint32_t keyHash, uint32_t command, int32_t alias) {
+	// Keep the load factor at or below one half so probe sequences stay short.
+	if ((used + 1) * 2 > slots.size()) {
+		grow();
+	}
+	size_t mask = slots.size() - 1;
+	size_t i = keyHash & mask;
+	while (slots[i].command != EMPTY_SLOT) {
+		i = (i + 1) & mask;
+	}
+	slots[i].hash = keyHash;
+	slots[i].command = command;
+	slots[i].alias = alias;
+	used++;
+}
+
+void CommandIndex::grow() {
+	rebuild(slots.empty() ? INITIAL_SLOTS : slots.size() * 2);
+}
+
+void CommandIndex::shrinkToFit() {
+#ifdef USE_SUGGESTIONS
+	suggestions.shrinkToFit();
+#endif
+	if (used == 0) {
+		std::vector<Slot>().swap(slots);
+		return;
+	}
+	size_t size = INITIAL_SLOTS;
+	while (size < used * 2)
+		size *= 2;
+	rebuild(size);
+}
+
+void CommandIndex::rebuild(size_t size) {
+	std::vector<Slot> old;
+	old.swap(slots);
+	Slot empty = { 0, EMPTY_SLOT, -1 };
+	slots.assign(size, empty);
+	used = 0;
+	for (size_t i = 0; i < old.size(); i++) {
+		if (old[i].command != EMPTY_SLOT) {
+			insertKey(old[i].hash, old[i].command, old[i].alias);
+		}
+	}
+}
+
+static const std::string* keyOf(const Command& cmd, int32_t alias) {
+	if (alias < 0)
+		return &cmd.name;
+	if ((size_t)alias < cmd.aliases.size())
+		return &cmd.aliases[alias];
+	return 0;
+}
+
+static const std::string* keyOf(const ArgSpec& spec, int32_t alias) {
+	return alias < 0 ? &spec.name : 0;
+}
+
+template <class T>
+int CommandIndex::findIn(const std::vector<T>& items, const char* token, size_t length) const {
+	if (slots.empty())
+		return -1;
+	uint32_t keyHash = hash(token, length);
+	size_t mask = slots.size() - 1;
+	size_t i = keyHash & mask;
+	while (slots[i].command != EMPTY_SLOT) {
+		if (slots[i].hash == keyHash && slots[i].command < items.size()) {
+			const std::string* key = keyOf(items[slots[i].command], slots[i].alias);
+			if (key && key->size() == length && std::memcmp(key->data(), token, length) == 0) {
+				return (int)slots[i].command;
+			}
+		}
+		i = (i + 1) & mask;
+	}
+	return -1;
+}
+
+int CommandIndex::find(const std::vector<Command>& commands, const char* token, size_t length) const {
+	return findIn(commands, token, length);
+}
+
+int CommandIndex::find(const std::vector<Command>& commands, const std::string& token) const {
+	return find(commands, token.data(), token.size());
+}
+
+const std::string* CommandIndex::findClash(const std::vector<Command>& commands, const Command& cmd) const {
+	if (find(commands, cmd.name) >= 0)
+		return &cmd.name;
+	for (size_t i = 0; i < cmd.aliases.size(); i++) {
+		if (find(commands, cmd.aliases[i]) >= 0)
+			return &cmd.aliases[i];
+	}
+	return 0;
+}
+
+void CommandIndex::insert(const std::vector<ArgSpec>& specs, size_t position) {
+	insertKey(hash(specs[position].name.data(), specs[position].name.size()), (uint32_t)position, -1);
+#ifdef USE_SUGGESTIONS
+	suggestions.insert(specs[position].name.data(), specs[position].name.size(), (uint32_t)position);
+#endif
+}
+
+int CommandIndex::find(const std::vector<ArgSpec>& specs, const char* token, size_t length) const {
+	return findIn(specs, token, length);
+}
+
+void CommandIndex::clear() {
+	slots.clear();
+	used = 0;
+#ifdef USE_SUGGESTIONS
+	suggestions.clear();
+#endif
+}
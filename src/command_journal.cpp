@@ -0,0 +1,242 @@
+// src/command_journal.cpp
+#include "command_journal.h"
+#include "command.h"
+#include <cstring>
+#ifdef RAPTORCLI_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+static uint16_t checksum(const uint8_t* data, size_t length) {
+	uint32_t h = FNV_OFFSET_BASIS;
+	for (size_t i = 0; i < length; i++) {
+		h = (h ^ data[i]) * FNV_PRIME;
+	}
+	return (uint16_t)h;
+}
+
+// Number of bytes varint(v) takes.
+static size_t varintSize(size_t v) {
+	size_t n = 1;
+	while (v >= 0x80) {
+		v >>= 7;
+		n++;
+	}
+	return n;
+}
+
+CommandJournal::CommandJournal()
+	: data(0), capacity(0), used(0), committed(0), records(0), dropped(0), groupSize(JOURNAL_DEFAULT_GROUP_SIZE),
+	pending(0), mapped(false) {
+}
+
+CommandJournal::~CommandJournal() {
+	close();
+}
+
+void CommandJournal::setBuffer(uint8_t* buffer, size_t size) {
+	close();
+	if (!buffer || size <= JOURNAL_HEADER_SIZE)
+		return;
+	data = buffer;
+	capacity = size;
+	if (!attach()) {
+		std::memset(data, 0, capacity);
+		attach();
+	}
+}
+
+#ifdef RAPTORCLI_MMAP
+bool CommandJournal::open(const char* path, size_t size) {
+	close();
+	if (size <= JOURNAL_HEADER_SIZE)
+		return false;
+	int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		return false;
+	}
+	if ((size_t)st.st_size < size) {
+		// Reserve the blocks now, so that a full disk fails here rather than as a fault on a later append.
+#ifdef __linux__
+		int failed = posix_fallocate(fd, 0, (off_t)size);
+#else
+		int failed = ftruncate(fd, (off_t)size);
+#endif
+		if (failed != 0) {
+			::close(fd);
+			return false;
+		}
+	}
+	else {
+		size = (size_t)st.st_size;
+	}
+	void* p = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	// The mapping keeps the file open.
+	::close(fd);
+	if (p == MAP_FAILED)
+		return false;
+	data = static_cast<uint8_t*>(p);
+	capacity = size;
+	mapped = true;
+	if (!attach()) {
+		close();
+		return false;
+	}
+	return true;
+}
+#endif
+
+void CommandJournal::close() {
+	if (!data)
+		return;
+	commit();
+#ifdef RAPTORCLI_MMAP
+	if (mapped)
+		munmap(data, capacity);
+#endif
+	data = 0;
+	capacity = used = committed = records = pending = 0;
+	mapped = false;
+}
+
+bool CommandJournal::attach() {
+	records = 0;
+	pending = 0;
+	if (std::memcmp(data, JOURNAL_MAGIC, JOURNAL_HEADER_SIZE - 1) == 0 && data[JOURNAL_HEADER_SIZE - 1] == JOURNAL_VERSION) {
+		size_t offset = begin();
+		const uint8_t* record;
+		size_t length;
+		while (next(offset, record, length)) {
+			records++;
+		}
+		used = committed = offset;
+		// Anything after the last good record is left over from a torn append. Zero it, so that the
+		// records appended from here on are followed by nothing but zeros.
+		for (size_t i = used; i < capacity; i++) {
+			if (data[i] != 0) {
+				std::memset(data + i, 0, capacity - i);
+#ifdef RAPTORCLI_MMAP
+				if (mapped)
+					msync(data, capacity, MS_SYNC);
+#endif
+				break;
+			}
+		}
+		return true;
+	}
+	for (size_t i = 0; i < capacity; i++) {
+		if (data[i] != 0)
+			return false;
+	}
+	std::memcpy(data, JOURNAL_MAGIC, JOURNAL_HEADER_SIZE - 1);
+	data[JOURNAL_HEADER_SIZE - 1] = JOURNAL_VERSION;
+	used = committed = begin();
+	return true;
+}
+
+void CommandJournal::clear() {
+	if (!data)
+		return;
+	std::memset(data + begin(), 0, used - begin());
+	used = committed = begin();
+	records = pending = 0;
+#ifdef RAPTORCLI_MMAP
+	if (mapped)
+		msync(data, capacity, MS_SYNC);
+#endif
+}
+
+bool CommandJournal::commit() {
+	pending = 0;
+	if (!data || committed == used)
+		return true;
+	bool ok = true;
+#ifdef RAPTORCLI_MMAP
+	if (mapped) {
+		// msync takes a page-aligned start.
+		size_t page = (size_t)sysconf(_SC_PAGESIZE);
+		size_t start = committed / page * page;
+		ok = msync(data + start, used - start, MS_SYNC) == 0;
+	}
+#endif
+	if (ok)
+		committed = used;
+	return ok;
+}
+
+bool CommandJournal::append(const Command& cmd, const ArgumentList& args, const int* slotPositions) {
+	// Keep room for the checksum and the terminating zero length.
+	if (!data || cmd.id == WIRE_NO_ID || capacity - used < 1 + JOURNAL_CHECKSUM_SIZE + 1) {
+		dropped++;
+		return false;
+	}
+	size_t slotCount = cmd.argSpecs.size();
+	size_t argCount = 0;
+	for (size_t slot = 0; slot < slotCount; slot++) {
+		if (slotPositions[slot] >= 0)
+			argCount++;
+	}
+	// Encode after a one-byte length, the common case, and move the command if its length needs more.
+	uint8_t* start = data + used;
+	WireWriter writer(start + 1, capacity - used - 1 - JOURNAL_CHECKSUM_SIZE - 1);
+	writer.beginCommand(cmd.id, argCount);
+	for (size_t slot = 0; slot < slotCount; slot++) {
+		if (slotPositions[slot] < 0)
+			continue;
+		const Argument& arg = args[slotPositions[slot]];
+		writer.beginArgument(slot, arg.values.size());
+		for (size_t i = 0; i < arg.values.size(); i++) {
+			writer.value(arg.values[i]);
+		}
+	}
+	size_t length = writer.size();
+	size_t lengthSize = varintSize(length);
+	if (!writer.ok() || lengthSize + length + JOURNAL_CHECKSUM_SIZE + 1 > capacity - used) {
+		std::memset(start + 1, 0, length);
+		dropped++;
+		return false;
+	}
+	if (lengthSize > 1)
+		std::memmove(start + lengthSize, start + 1, length);
+	uint16_t sum = checksum(start + lengthSize, length);
+	start[lengthSize + length] = (uint8_t)sum;
+	start[lengthSize + length + 1] = (uint8_t)(sum >> 8);
+	start[lengthSize + length + JOURNAL_CHECKSUM_SIZE] = 0;
+	WireWriter header(start, lengthSize);
+	header.varint((uint32_t)length);
+	used += lengthSize + length + JOURNAL_CHECKSUM_SIZE;
+	records++;
+	if (++pending >= groupSize)
+		commit();
+	return true;
+}
+
+bool CommandJournal::next(size_t& offset, const uint8_t*& record, size_t& length) const {
+	if (!data || offset >= capacity)
+		return false;
+	WireReader reader(data + offset, capacity - offset);
+	uint32_t n;
+	if (!reader.varint(n) || n == 0)
+		return false;
+	// Compare without adding to n, which a corrupt length could make wrap around.
+	size_t remaining = capacity - offset - reader.getPosition();
+	if ((size_t)n > remaining || JOURNAL_CHECKSUM_SIZE > remaining - n)
+		return false;
+	const uint8_t* start = data + offset + reader.getPosition();
+	uint16_t sum = (uint16_t)(start[n] | (start[n + 1] << 8));
+	if (sum != checksum(start, n))
+		return false;
+	record = start;
+	length = n;
+	offset += reader.getPosition() + n + JOURNAL_CHECKSUM_SIZE;
+	return true;
+}
@@ -0,0 +1,86 @@
+// src/command_stats.cpp
+#include "command_stats.h"
+#include "RaptorCLI.h"
+#include <cstring>
+#ifndef ARDUINO
+#include <chrono>
+#endif
+
+static const char* const STATS_ERROR_CODES[STATS_ERROR_COUNT] = {
+	ERROR_CMD_UNKNOWN,
+	ERROR_CMD_UNEXPECTED_TOKEN,
+	ERROR_CMD_DUPLICATE_HELP_FLAG,
+	ERROR_CMD_DUPLICATE_NAME,
+	ERROR_CMD_MISSING_REQUIRED_ARG,
+	ERROR_CMD_TYPE_MISMATCH,
+	ERROR_CMD_NO_CALLBACK,
+	ERROR_CMD_OUT_OF_MEMORY,
+	ERROR_CMD_INPUT_TOO_LONG,
+	ERROR_CMD_MALFORMED_FRAME,
+	ERROR_CMD_UNKNOWN_ARG
+};
+
+const char* statsErrorCode(StatsError error) {
+	return error < STATS_ERROR_COUNT ? STATS_ERROR_CODES[error] : "";
+}
+
+uint32_t statsClock() {
+#ifdef ARDUINO
+	return (uint32_t)(micros() * 1000UL);
+#else
+	return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void LatencyHistogram::reset() {
+	std::memset(buckets, 0, sizeof(buckets));
+	count = 0;
+}
+
+void LatencyHistogram::record(uint32_t nanoseconds) {
+	unsigned bucket = 0;
+#if defined(__GNUC__)
+	if (nanoseconds > 1)
+		bucket = 31 - __builtin_clz(nanoseconds);
+#else
+	while (nanoseconds > 1) {
+		nanoseconds >>= 1;
+		bucket++;
+	}
+#endif
+	if (bucket >= STATS_HISTOGRAM_BUCKETS)
+		bucket = STATS_HISTOGRAM_BUCKETS - 1;
+	buckets[bucket]++;
+	count++;
+}
+
+uint32_t LatencyHistogram::percentile(unsigned percent) const {
+	if (count == 0)
+		return 0;
+	uint64_t target = ((uint64_t)count * percent + 99) / 100;
+	if (target == 0)
+		target = 1;
+	uint64_t seen = 0;
+	for (unsigned i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+		seen += buckets[i];
+		if (seen >= target)
+			return i >= 31 ? 0xFFFFFFFFu : (2u << i);
+	}
+	return 0xFFFFFFFFu;
+}
+
+void CommandStats::reset() {
+	dispatches = 0;
+	std::memset(errors, 0, sizeof(errors));
+	parse.reset();
+	callback.reset();
+}
+
+uint32_t CommandStats::errorCount() const {
+	uint32_t total = 0;
+	for (unsigned i = 0; i < STATS_ERROR_COUNT; i++) {
+		total += errors[i];
+	}
+	return total;
+}
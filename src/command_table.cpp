@@ -0,0 +1,122 @@
+// src/command_table.cpp
+#include "command_table.h"
+#include "command_index.h"
+#include <cstring>
+#include <cstdio>
+#ifndef ARDUINO
+#include <iostream>
+#endif
+
+bool TableName::matches(const char* token, size_t length, uint32_t tokenHash) const {
+	return hash == tokenHash && std::strlen(text) == length && std::memcmp(text, token, length) == 0;
+}
+
+Value TableArgSpec::defaultAsValue() const {
+	switch (defaultValue.type) {
+	case VAL_INT: return Value(defaultValue.intValue);
+	case VAL_DOUBLE: return Value(defaultValue.doubleValue);
+	case VAL_BOOL: return Value(defaultValue.intValue != 0);
+	case VAL_STRING: return Value::borrowString(defaultValue.stringValue, std::strlen(defaultValue.stringValue));
+	default: return Value();
+	}
+}
+
+const TableCommand* TableCommand::find(const TableCommand* commands, size_t count, const char* token, size_t length) {
+	uint32_t tokenHash = CommandIndex::hash(token, length);
+	for (size_t i = 0; i < count; i++) {
+		if (commands[i].name.matches(token, length, tokenHash))
+			return &commands[i];
+	}
+	for (size_t i = 0; i < count; i++) {
+		for (size_t a = 0; a < commands[i].aliasCount; a++) {
+			if (commands[i].aliases[a].matches(token, length, tokenHash))
+				return &commands[i];
+		}
+	}
+	return 0;
+}
+
+int TableCommand::argSlot(const char* token, size_t length) const {
+	uint32_t tokenHash = CommandIndex::hash(token, length);
+	for (size_t i = 0; i < argCount; i++) {
+		if (argSpecs[i].name.matches(token, length, tokenHash))
+			return (int)i;
+	}
+	return -1;
+}
+
+void TableCommand::printUsage(const std::string& prefix, CLIOutput* out) const {
+	if (!out) {
+#ifdef ARDUINO
+		Serial.println((prefix + name.text + " - " + description).c_str());
+#else
+		std::cout << prefix << name.text << " - " << description << std::endl;
+#endif
+		return;
+	}
+	HelpWriter writer(out);
+	writer.setPrefix(prefix.data(), prefix.size());
+	writeUsage(writer);
+}
+
+// Tables live in read-only memory, so their usage is streamed piece by piece instead of cached.
+void TableCommand::writeUsage(HelpWriter& writer, size_t indent) const {
+	writer.beginLine(indent);
+	writer.text(name.text);
+	if (aliasCount > 0) {
+		writer.text(" (aliases: ");
+		for (size_t i = 0; i < aliasCount; i++) {
+			writer.text(aliases[i].text);
+			if (i < (size_t)aliasCount - 1) {
+				writer.text(", ");
+			}
+		}
+		writer.text(")");
+	}
+	writer.text(" - ");
+	writer.text(description);
+	writer.endLine();
+	if (argCount > 0) {
+		writer.line(indent, "  Arguments:", 12);
+		for (size_t i = 0; i < argCount; i++) {
+			const TableArgSpec& spec = argSpecs[i];
+			writer.beginLine(indent);
+			writer.text("    -");
+			writer.text(spec.name.text);
+			writer.text(" (");
+			writer.text(valueTypeName(spec.type));
+			writer.text(spec.required ? ") required" : ") optional");
+			if (spec.hasDefault()) {
+				char buffer[32];
+				writer.text(", default = ");
+				switch (spec.defaultValue.type) {
+				case VAL_INT:
+					std::sprintf(buffer, "%d", spec.defaultValue.intValue);
+					writer.text(buffer);
+					break;
+				case VAL_DOUBLE:
+					std::sprintf(buffer, "%f", spec.defaultValue.doubleValue);
+					writer.text(buffer);
+					break;
+				case VAL_BOOL:
+					writer.text(spec.defaultValue.intValue ? BOOL_TRUE : BOOL_FALSE);
+					break;
+				default:
+					writer.text(spec.defaultValue.stringValue);
+					break;
+				}
+			}
+			if (spec.helpText && spec.helpText[0]) {
+				writer.text(" -- ");
+				writer.text(spec.helpText);
+			}
+			writer.endLine();
+		}
+	}
+	if (subcommandCount > 0) {
+		writer.line(indent, "  Subcommands:", 14);
+		for (size_t i = 0; i < subcommandCount; i++) {
+			subcommands[i].writeUsage(writer, indent + HELP_INDENT_STEP);
+		}
+	}
+}
@@ -0,0 +1,256 @@
+// src/completer.cpp
+#include "completer.h"
+#include <cctype>
+#include <cstring>
+
+#define DASH_CHAR '-'
+#define DECIMAL_POINT '.'
+#define COMPLETION_SEPARATOR ' '
+
+static const char* const BOOL_VALUES[] = { "true", "false" };
+
+// A flag is a word starting with a dash that is not a negative number, as the dispatcher decides.
+static bool isFlagWord(const char* word, size_t length) {
+	if (length == 0 || word[0] != DASH_CHAR)
+		return false;
+	if (length == 1)
+		return true;
+	return !std::isdigit((unsigned char)word[1]) && word[1] != DECIMAL_POINT;
+}
+
+Completer::Completer(const Dispatcher& dispatcher) : dispatcher(dispatcher), wordStart(0) {
+}
+
+Completer::Path Completer::emptyPath() {
+	Path path = { 0, 0, false, false, -1, 0, 0 };
+	return path;
+}
+
+void Completer::reset() {
+	line.clear();
+	checkpoints.clear();
+	completions.clear();
+	wordStart = 0;
+}
+
+size_t Completer::complete(const char* input, size_t length, size_t cursor) {
+	if (cursor > length)
+		cursor = length;
+	// Resume after the last word that lies entirely in the part of the line that is unchanged.
+	size_t same = 0;
+	size_t limit = line.size() < cursor ? line.size() : cursor;
+	while (same < limit && line[same] == input[same])
+		same++;
+	while (!checkpoints.empty() && checkpoints.back().offset > same)
+		checkpoints.pop_back();
+	size_t offset = checkpoints.empty() ? 0 : checkpoints.back().offset;
+	Path path = checkpoints.empty() ? emptyPath() : checkpoints.back().path;
+	line.resize(offset);
+	line.append(input + offset, cursor - offset);
+
+	TokenizerState state = TS_OUTSIDE;
+	unsigned depth = 0;
+	size_t begin = offset;
+	bool quoted = false;
+	for (size_t i = offset; i < cursor; i++) {
+		char c = line[i];
+		if (state == TS_OUTSIDE && (std::isspace((unsigned char)c) || c == COMMAND_DELIMITER)) {
+			bool ended = i > begin;
+			if (ended)
+				addWord(path, begin, i, quoted);
+			begin = i + 1;
+			quoted = false;
+			if (c == COMMAND_DELIMITER)
+				path = emptyPath();
+			else if (!ended)
+				continue;
+			Checkpoint checkpoint = { begin, path };
+			checkpoints.push_back(checkpoint);
+			continue;
+		}
+		if (state == TS_OUTSIDE && (c == QUOTE_CHAR || (c == LIST_START && i == begin)))
+			quoted = true;
+		state = Lexer::splitStep(state, depth, c);
+	}
+
+	completions.clear();
+	wordStart = begin;
+	// Quoted words and lists are values with nothing to complete.
+	if (state == TS_OUTSIDE && !quoted)
+		collect(path, begin, cursor);
+	return completions.size();
+}
+
+void Completer::addWord(Path& path, size_t begin, size_t end, bool quoted) const {
+	if (path.failed)
+		return;
+	const char* word = line.data() + begin;
+	size_t length = end - begin;
+	if (!path.command && !path.entry) {
+		const Dispatcher& tree = dispatcher.tree();
+		int position = tree.commandIndex.find(tree.commands, word, length);
+		if (position >= 0)
+			path.command = &tree.commands[position];
+		else
+			path.entry = TableCommand::find(tree.table, tree.tableSize, word, length);
+		path.failed = !path.command && !path.entry;
+		return;
+	}
+	if (!quoted && isFlagWord(word, length)) {
+		path.inArguments = true;
+		path.flag = path.command ? path.command->argSlot(word + 1, length - 1) : path.entry->argSlot(word + 1, length - 1);
+		path.flagValues = 0;
+		if (path.flag >= 0)
+			path.seenSlots |= (uint64_t)1 << path.flag;
+		return;
+	}
+	if (path.inArguments) {
+		path.flagValues++;
+		return;
+	}
+	// Words before the first flag name subcommands; any other word fails the dispatch.
+	if (path.command) {
+		path.command = path.command->findSubcommand(word, length);
+		path.failed = !path.command;
+	}
+	else {
+		path.entry = path.entry->findSubcommand(word, length);
+		path.failed = !path.entry;
+	}
+}
+
+void Completer::collect(const Path& path, size_t begin, size_t end) {
+	if (path.failed)
+		return;
+	const char* word = line.data() + begin;
+	size_t length = end - begin;
+	if (!path.command && !path.entry) {
+		collectCommands(word, length);
+		return;
+	}
+	if (isFlagWord(word, length)) {
+		collectFlags(path, word + 1, length - 1);
+		return;
+	}
+	if (!path.inArguments) {
+		collectSubcommands(path, word, length);
+		if (length == 0)
+			collectFlags(path, word, 0);
+		return;
+	}
+	if (path.flag >= 0 && path.flagValues == 0) {
+		// The flag still needs its value.
+		ValueType type = path.command ? path.command->argSpecs[path.flag].type : path.entry->argSpecs[path.flag].type;
+		if (type == VAL_BOOL) {
+			for (size_t i = 0; i < sizeof(BOOL_VALUES) / sizeof(BOOL_VALUES[0]); i++) {
+				add(BOOL_VALUES[i], std::strlen(BOOL_VALUES[i]), COMPLETION_VALUE, word, length);
+			}
+		}
+		return;
+	}
+	if (length == 0)
+		collectFlags(path, word, 0);
+}
+
+void Completer::collectCommands(const char* prefix, size_t length) {
+	const Dispatcher& tree = dispatcher.tree();
+	for (size_t i = 0; i < tree.commands.size(); i++) {
+		const Command& cmd = tree.commands[i];
+		add(cmd.name.data(), cmd.name.size(), COMPLETION_COMMAND, prefix, length);
+		for (size_t a = 0; a < cmd.aliases.size(); a++) {
+			add(cmd.aliases[a].data(), cmd.aliases[a].size(), COMPLETION_ALIAS, prefix, length);
+		}
+	}
+	for (size_t i = 0; i < tree.tableSize; i++) {
+		const TableCommand& entry = tree.table[i];
+		// Registered commands take precedence over table entries with the same name.
+		if (tree.commandIndex.find(tree.commands, entry.name.text, std::strlen(entry.name.text)) >= 0)
+			continue;
+		add(entry.name.text, std::strlen(entry.name.text), COMPLETION_COMMAND, prefix, length);
+		for (size_t a = 0; a < entry.aliasCount; a++) {
+			add(entry.aliases[a].text, std::strlen(entry.aliases[a].text), COMPLETION_ALIAS, prefix, length);
+		}
+	}
+}
+
+void Completer::collectSubcommands(const Path& path, const char* prefix, size_t length) {
+	if (path.command) {
+		const std::vector<Command>& subcommands = path.command->subcommands;
+		for (size_t i = 0; i < subcommands.size(); i++) {
+			add(subcommands[i].name.data(), subcommands[i].name.size(), COMPLETION_COMMAND, prefix, length);
+			for (size_t a = 0; a < subcommands[i].aliases.size(); a++) {
+				const std::string& alias = subcommands[i].aliases[a];
+				add(alias.data(), alias.size(), COMPLETION_ALIAS, prefix, length);
+			}
+		}
+		return;
+	}
+	for (size_t i = 0; i < path.entry->subcommandCount; i++) {
+		const TableCommand& sub = path.entry->subcommands[i];
+		add(sub.name.text, std::strlen(sub.name.text), COMPLETION_COMMAND, prefix, length);
+		for (size_t a = 0; a < sub.aliasCount; a++) {
+			add(sub.aliases[a].text, std::strlen(sub.aliases[a].text), COMPLETION_ALIAS, prefix, length);
+		}
+	}
+}
+
+void Completer::collectFlags(const Path& path, const char* prefix, size_t length) {
+	size_t count = path.command ? path.command->argSpecs.size() : path.entry->argCount;
+	for (size_t slot = 0; slot < count; slot++) {
+		if (slot < MAX_ARG_SPECS && (path.seenSlots & ((uint64_t)1 << slot)))
+			continue;
+		if (path.command) {
+			const std::string& name = path.command->argSpecs[slot].name;
+			add(name.data(), name.size(), COMPLETION_FLAG, prefix, length);
+		}
+		else {
+			const char* name = path.entry->argSpecs[slot].name.text;
+			add(name, std::strlen(name), COMPLETION_FLAG, prefix, length);
+		}
+	}
+}
+
+void Completer::add(const char* text, size_t length, CompletionKind kind, const char* prefix, size_t prefixLength) {
+	if (length < prefixLength || std::memcmp(text, prefix, prefixLength) != 0)
+		return;
+	Completion completion = { text, length, kind };
+	completions.push_back(completion);
+}
+
+// Character i of the word a completion stands for.
+static char wordChar(const Completion& completion, size_t i) {
+	if (completion.kind == COMPLETION_FLAG)
+		return i == 0 ? DASH_CHAR : completion.text[i - 1];
+	return completion.text[i];
+}
+
+size_t Completer::commonLength() const {
+	if (completions.empty())
+		return 0;
+	size_t common = completions[0].wordLength();
+	for (size_t i = 1; i < completions.size(); i++) {
+		size_t n = completions[i].wordLength() < common ? completions[i].wordLength() : common;
+		size_t k = 0;
+		while (k < n && wordChar(completions[i], k) == wordChar(completions[0], k))
+			k++;
+		common = k;
+	}
+	return common;
+}
+
+void Completer::print(CLIOutput* out) const {
+	if (!out)
+		out = dispatcher.output;
+	if (!out)
+		return;
+	const char separator = COMPLETION_SEPARATOR;
+	const char dash = DASH_CHAR;
+	for (size_t i = 0; i < completions.size(); i++) {
+		if (i > 0)
+			out->write(&separator, 1);
+		if (completions[i].kind == COMPLETION_FLAG)
+			out->write(&dash, 1);
+		out->write(completions[i].text, completions[i].length);
+	}
+	out->println();
+}
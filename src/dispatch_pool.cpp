@@ -0,0 +1,162 @@
+// src/dispatch_pool.cpp
+#include "dispatch_pool.h"
+
+#ifdef RAPTORCLI_THREADS
+
+#include <utility>
+
+DispatchPool::DispatchPool(Dispatcher& source, size_t count)
+	: nextWorker(0), queuedJobs(0), outstanding(0), stopping(false), completed(0), failed(0) {
+	source.freeze();
+	if (count == 0)
+		count = std::thread::hardware_concurrency();
+	if (count == 0)
+		count = 1;
+	for (size_t i = 0; i < count; i++) {
+		Worker* worker = new Worker();
+		worker->dispatcher = new Dispatcher(&source);
+		workers.push_back(worker);
+	}
+	// Start the threads only once every worker exists, since they steal from each other.
+	for (size_t i = 0; i < count; i++) {
+		workers[i]->thread = std::thread(&DispatchPool::run, this, i);
+	}
+}
+
+DispatchPool::~DispatchPool() {
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+	for (size_t i = 0; i < workers.size(); i++) {
+		workers[i]->thread.join();
+	}
+	for (size_t i = 0; i < workers.size(); i++) {
+		delete workers[i]->dispatcher;
+		delete workers[i];
+	}
+}
+
+void DispatchPool::submit(const std::string& input, uint32_t connection) {
+	submit(input.data(), input.size(), connection);
+}
+
+void DispatchPool::submit(const char* input, size_t length, uint32_t connection) {
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		outstanding++;
+	}
+	Job job;
+	job.connection = connection;
+	if (connection == POOL_UNORDERED) {
+		job.input.assign(input, length);
+		push(nextWorker++ % workers.size(), std::move(job));
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		Connection& pending = connections[connection];
+		pending.pending.push_back(std::string(input, length));
+		if (pending.scheduled)
+			return;
+		pending.scheduled = true;
+	}
+	// A connection starts on the same worker each time; stealing moves it when that worker is busy.
+	push(connection % workers.size(), std::move(job));
+}
+
+void DispatchPool::wait() {
+	std::unique_lock<std::mutex> lock(stateMutex);
+	idle.wait(lock, [this] { return outstanding == 0; });
+}
+
+// The job is queued and counted under stateMutex together, so a thief that finds it always
+// finds it counted; pop only takes stateMutex after letting go of the queue, so the order is safe.
+void DispatchPool::push(size_t worker, Job&& job) {
+	{
+		std::lock_guard<std::mutex> state(stateMutex);
+		std::lock_guard<std::mutex> lock(workers[worker]->mutex);
+		workers[worker]->jobs.push_back(std::move(job));
+		queuedJobs++;
+	}
+	workAvailable.notify_one();
+}
+
+// Take the oldest job of the worker's own queue, or else steal the newest job of another worker.
+bool DispatchPool::pop(size_t worker, Job& job) {
+	bool found = false;
+	for (size_t i = 0; i < workers.size() && !found; i++) {
+		Worker& victim = *workers[(worker + i) % workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (victim.jobs.empty())
+			continue;
+		if (i == 0) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+		}
+		else {
+			job = std::move(victim.jobs.back());
+			victim.jobs.pop_back();
+		}
+		found = true;
+	}
+	if (found) {
+		std::lock_guard<std::mutex> lock(stateMutex);
+		queuedJobs--;
+	}
+	return found;
+}
+
+void DispatchPool::run(size_t worker) {
+	Job job;
+	for (;;) {
+		if (pop(worker, job)) {
+			execute(worker, job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(stateMutex);
+		workAvailable.wait(lock, [this] { return queuedJobs > 0 || stopping; });
+		// A job still running may queue its connection's next turn, but it does so on its own worker.
+		if (queuedJobs == 0 && stopping)
+			return;
+	}
+}
+
+void DispatchPool::execute(size_t worker, Job& job) {
+	Dispatcher& dispatcher = *workers[worker]->dispatcher;
+	if (job.connection == POOL_UNORDERED) {
+		finish(dispatcher.dispatch(job.input));
+		return;
+	}
+	std::string input;
+	{
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		Connection& pending = connections[job.connection];
+		input.swap(pending.pending.front());
+		pending.pending.pop_front();
+	}
+	bool success = dispatcher.dispatch(input);
+	bool more;
+	{
+		std::lock_guard<std::mutex> lock(connectionsMutex);
+		more = !connections[job.connection].pending.empty();
+		if (!more)
+			connections.erase(job.connection);
+	}
+	// Requeue the connection behind the jobs already waiting here, so busy connections take turns.
+	if (more)
+		push(worker, std::move(job));
+	finish(success);
+}
+
+void DispatchPool::finish(bool success) {
+	completed++;
+	if (!success)
+		failed++;
+	std::lock_guard<std::mutex> lock(stateMutex);
+	if (--outstanding == 0)
+		idle.notify_all();
+}
+
+#endif
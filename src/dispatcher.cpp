@@ -2,104 +2,73 @@
 #include "dispatcher.h"
 #include "clioutput.h"
 #include "RaptorCLI.h"
+#include "scalar_parser.h"
 #include <sstream>
 #include <cctype>
 #include <cstdlib>
 #include <cstdio>
-#include <set>
+#include <cstring>
+#include <stdint.h>
 
-namespace {
-	static Dispatcher* gDispatcher = nullptr;
-}
-
-#define QUOTE_CHAR '"'  
-#define ESCAPE_CHAR '\\'  
 #define DASH_CHAR '-'
 #define DECIMAL_POINT '.'
 #define DELIMITER_CHAR ','
 #define NULL_CHAR '\0'
 #define HELP_FLAG_SHORT "h"  
 #define HELP_FLAG_LONG "help"
-#define LIST_START '['
-#define LIST_END ']'
-#define COMMAND_DELIMITER ';'
-
-// Helper function to trim whitespace from both ends of a string.
-static std::string trim(const std::string& s) {
-	size_t start = 0;
-	while (start < s.size() && std::isspace(s[start]))
-		start++;
-	size_t end = s.size();
-	while (end > start && std::isspace(s[end - 1]))
-		end--;
-	return s.substr(start, end - start);
-}
-
-// Splits input string into separate commands using ';' as delimiter.
-enum SplitState { SS_OUTSIDE, SS_IN_QUOTE, SS_IN_ESCAPE, SS_IN_LIST };
-static std::vector<std::string> splitCommands(const std::string& input) {
-	std::vector<std::string> commands;
-	std::string current;
-	SplitState state = SS_OUTSIDE;
-	for (char c : input) {
-		switch (state) {
-		case SS_OUTSIDE:
-			if (c == COMMAND_DELIMITER) {
-				commands.push_back(current);
-				current.clear();
-			}
-			else if (c == QUOTE_CHAR) {
-				state = SS_IN_QUOTE;
-				current.push_back(c);
-			}
-			else if (c == LIST_START) {
-				state = SS_IN_LIST;
-				current.push_back(c);
-			}
-			else {
-				current.push_back(c);
-			}
-			break;
-		case SS_IN_QUOTE:
-			if (c == ESCAPE_CHAR) {
-				state = SS_IN_ESCAPE;
-				current.push_back(c);
-			}
-			else if (c == QUOTE_CHAR) {
-				state = SS_OUTSIDE;
-				current.push_back(c);
-			}
-			else {
-				current.push_back(c);
-			}
-			break;
-		case SS_IN_ESCAPE:
-			current.push_back(c);
-			state = SS_IN_QUOTE;
-			break;
-		case SS_IN_LIST:
-			current.push_back(c);
-			if (c == LIST_END) {
-				state = SS_OUTSIDE;
-			}
-			break;
+#define STATS_COMMAND_RESET_SLOT 0
+#define HELP_COMMAND_PATH_SLOT 0
+#define HELP_COMMAND_PAGE_SLOT 1
+#define HELP_COMMAND_LINES_SLOT 2
+#define HELP_PAGE_LINES 20 // Default page size of the help command
+#define HELP_GLOBAL_INDENT 2
+
+// Count an error in the statistics; compiles to nothing without USE_COMMAND_STATS.
+#ifdef USE_COMMAND_STATS
+#define RECORD_ERROR(cmd, error) recordError(cmd, error)
+#else
+#define RECORD_ERROR(cmd, error)
+#endif
+
+// A flag is a token starting with a dash that is not a negative number.
+static bool isFlagToken(const Token& token) {
+	if (token.length == 0 || token.isQuoted())
+		return false;
+	if (token.data[0] != DASH_CHAR)
+		return false;
+	if (token.length == 1)
+		return true;
+	if (std::isdigit((unsigned char)token.data[1]) || token.data[1] == DECIMAL_POINT)
+		return false;
+	return true;
+}
+
+void Dispatcher::reportError(const CLIError& error) {
+	if (batchEntry) {
+		if (!batchEntry->error) {
+			batchEntry->code = error.code;
+			batchEntry->offset = error.offset;
+#ifdef USE_DESCRIPTIVE_ERRORS
+			batchMessages.push_back(error.text());
+			batchEntry->error = batchMessages.back().c_str();
+#else
+			batchEntry->error = error.codeString();
+#endif
 		}
+		return;
 	}
-	if (!current.empty()) {
-		commands.push_back(current);
+	if (errorHandler) {
+		errorHandler(error);
+		return;
 	}
-	return commands;
-}
-
-// Helper to report an error via the registered output (or Serial as fallback, just in case).
-void Dispatcher::reportError(const std::string& msg) {
 #ifdef USE_DESCRIPTIVE_ERRORS
 	if (output) {
-		output->println(msg);
+		error.print(output);
+		output->println();
 	}
 #else
 	if (errorCallback) {
-		errorCallback(msg);
+		errorCallback(error.codeString());
 	}
 #endif
 }
@@ -108,453 +77,1091 @@ void Dispatcher::registerErrorCallback(ErrorCallback callback) {
 	errorCallback = callback;
 }
 
-bool Dispatcher::dispatchSingleCommand(const std::string& command) {
-	std::vector<std::string> tokens = tokenize(command);
-	size_t index = 0;
-	const Command* cmd = matchCommand(tokens, index);
-	if (!cmd) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-		reportError("Unknown command: " + tokens[0]);
-#else
-		reportError(ERROR_CMD_UNKNOWN);
-#endif
+void Dispatcher::registerErrorHandler(ErrorHandler handler) {
+	errorHandler = handler;
+}
+
+bool Dispatcher::dispatchSingleCommand(const Token& command) {
+	TokenList tokens((ArenaAllocator<Token>(&arena)));
+	if (!Lexer::tokenize(command.data, command.length, tokens)) {
+		RECORD_ERROR(0, STATS_ERROR_OUT_OF_MEMORY);
+		reportError(CLIError(CLI_ERROR_OUT_OF_MEMORY));
 		return false;
 	}
-	if (index < tokens.size() && (tokens[index].empty() || tokens[index][0] != DASH_CHAR)) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-		reportError("Unexpected token: " + tokens[index]);
-#else
-		reportError(ERROR_CMD_UNEXPECTED_TOKEN);
-#endif
-		return false;
+	return dispatchTokensInScope(tokens);
+}
+
+// Tokens from a caller may point anywhere, so their errors are located from the first token.
+bool Dispatcher::dispatchTokens(const TokenList& tokens) {
+	DispatchScope scope(*this);
+	InputScope text(*this, 0);
+#ifdef RAPTORCLI_EXCEPTIONS
+	try {
+		return dispatchTokensInScope(tokens);
 	}
-	std::vector<Argument> parsedArgs;
-	if (!parseArguments(tokens, index, parsedArgs)) {
+	catch (const std::bad_alloc&) {
+		RECORD_ERROR(0, STATS_ERROR_OUT_OF_MEMORY);
+		reportError(CLIError(CLI_ERROR_OUT_OF_MEMORY));
 		return false;
 	}
-	bool foundHelpShort = false, foundHelpLong = false;
-	for (size_t i = 0; i < parsedArgs.size(); i++) {
-		if (parsedArgs[i].name == HELP_FLAG_SHORT)
-			foundHelpShort = true;
-		if (parsedArgs[i].name == HELP_FLAG_LONG)
-			foundHelpLong = true;
-	}
-	if (foundHelpShort && foundHelpLong) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-		reportError("Duplicate help flag: both -h and -help provided.");
 #else
-		reportError(ERROR_CMD_DUPLICATE_HELP_FLAG);
+	return dispatchTokensInScope(tokens);
+#endif
+}
+
+bool Dispatcher::dispatchTokensInScope(const TokenList& tokens) {
+#ifdef USE_COMMAND_STATS
+	uint32_t started = statsClock();
+	stats.dispatches++;
+#else
+	uint32_t started = 0;
+#endif
+	size_t index = 0;
+	const Command* cmd = matchCommand(tokens, index);
+	if (cmd)
+		return runCommand(CommandSpecs(*cmd, shared != 0), tokens, index, started);
+	const TableCommand* entry = matchTable(tokens, index);
+	if (entry)
+		return runCommand(TableSpecs(*entry), tokens, index, started);
+	RECORD_ERROR(0, STATS_ERROR_UNKNOWN_COMMAND);
+	CLIError error(CLI_ERROR_UNKNOWN_COMMAND);
+	locateToken(error, tokens, 0);
+#ifdef USE_SUGGESTIONS
+	if (!tokens.empty())
+		tree().commandIndex.suggest(tokens[0].data, tokens[0].length, suggestions);
+	error.suggestions = &suggestions;
+#endif
+	reportError(error);
+#ifdef USE_SUGGESTIONS
+	suggestions.count = 0;
 #endif
+	return false;
+}
+
+template <class Specs>
+bool Dispatcher::runCommand(const Specs& specs, const TokenList& tokens, size_t index, uint32_t started) {
+#ifdef USE_COMMAND_STATS
+	const Command* cmd = specs.statsCommand();
+	if (cmd)
+		cmd->stats.dispatches++;
+#endif
+	if (index < tokens.size() && !isFlagToken(tokens[index])) {
+		RECORD_ERROR(specs.statsCommand(), STATS_ERROR_UNEXPECTED_TOKEN);
+		CLIError error(CLI_ERROR_UNEXPECTED_TOKEN);
+		specs.locate(error);
+		locateToken(error, tokens, index);
+#ifdef USE_SUGGESTIONS
+		// The token may be a misspelt subcommand.
+		specs.suggestSubcommands(tokens[index], suggestions);
+		error.suggestions = &suggestions;
+#endif
+		reportError(error);
+#ifdef USE_SUGGESTIONS
+		suggestions.count = 0;
+#endif
+		return false;
+	}
+	// parsedArgs holds one entry per flag in token order; slotPositions maps each spec slot into it.
+	arena.clearOverflow();
+	ArgumentList parsedArgs((ArenaAllocator<Argument>(&arena)));
+	SlotList slotPositions((ArenaAllocator<int>(&arena)));
+	if (!reserveRoom(slotPositions, specs.count()))
+		return outOfMemory(specs);
+	slotPositions.assign(specs.count(), -1);
+	bool help = false;
+	if (!parseArguments(tokens, index, specs, parsedArgs, slotPositions, help)) {
 		return false;
 	}
-	if (foundHelpShort || foundHelpLong) {
-		cmd->printUsage("", output);
+	if (help) {
+		specs.printUsage(output);
 		return true;
 	}
-	std::vector<Argument> mergedArgs;
-	for (size_t i = 0; i < cmd->argSpecs.size(); i++) {
-		const ArgSpec& spec = cmd->argSpecs[i];
-		bool found = false;
-		for (size_t j = 0; j < parsedArgs.size(); j++) {
-			if (parsedArgs[j].name == spec.name) {
-				if (parsedArgs[j].values.empty()) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-					reportError("Argument " + spec.name + " has no value.");
-#else
-					reportError(ERROR_CMD_MISSING_REQUIRED_ARG);
-#endif
-					return false;
-				}
-				Value provided = parsedArgs[j].values[0];
-				if (spec.type == VAL_DOUBLE) {
-					if (provided.type == VAL_INT) {
-						provided.doubleValue = (double)provided.intValue;
-						provided.type = VAL_DOUBLE;
-					}
-					else if (provided.type != VAL_DOUBLE) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-						reportError("Type mismatch for argument: " + spec.name);
+	return invokeParsed(specs, parsedArgs, slotPositions, started);
+}
+
+template <class Specs>
+bool Dispatcher::invokeParsed(const Specs& specs, ArgumentList& parsedArgs, SlotList& slotPositions, uint32_t started) {
+	ArgumentList mergedArgs((ArenaAllocator<Argument>(&arena)));
+	if (!bindArguments(specs, parsedArgs, slotPositions, mergedArgs)) {
+		return false;
+	}
+#ifdef USE_COMMAND_STATS
+	const Command* cmd = specs.statsCommand();
+	uint32_t parsed = statsClock();
+	if (cmd)
+		cmd->stats.parse.record(parsed - started);
+	stats.parse.record(parsed - started);
 #else
-						reportError(ERROR_CMD_TYPE_MISMATCH);
+	(void)started;
 #endif
-						return false;
-					}
-				}
-				else if (provided.type != spec.type) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-					reportError("Type mismatch for argument: " + spec.name);
-#else
-					reportError(ERROR_CMD_TYPE_MISMATCH);
+	if (specs.invoke(mergedArgs, output, slotPositions.empty() ? nullptr : slotPositions.data(), this)) {
+#ifdef USE_COMMAND_STATS
+		uint32_t elapsed = statsClock() - parsed;
+		if (cmd)
+			cmd->stats.callback.record(elapsed);
+		stats.callback.record(elapsed);
 #endif
-					return false;
-				}
-				parsedArgs[j].values[0] = provided;
-				mergedArgs.push_back(parsedArgs[j]);
-				found = true;
-				break;
+		if (journal && !replaying && specs.journalCommand())
+			journal->append(*specs.journalCommand(), mergedArgs, slotPositions.empty() ? nullptr : slotPositions.data());
+		return true;
+	}
+	else {
+		RECORD_ERROR(specs.statsCommand(), STATS_ERROR_NO_CALLBACK);
+		CLIError error(CLI_ERROR_NO_CALLBACK);
+		specs.locate(error);
+		reportError(error);
+		return false;
+	}
+}
+
+// Bind in slot order: check that provided flags have a value, fill in defaults, and remap slotPositions to mergedArgs.
+template <class Specs>
+bool Dispatcher::bindArguments(const Specs& specs, ArgumentList& parsedArgs, SlotList& slotPositions,
+	ArgumentList& mergedArgs) {
+	if (!reserveRoom(mergedArgs, specs.count()))
+		return outOfMemory(specs);
+	for (size_t slot = 0; slot < specs.count(); slot++) {
+		int position = slotPositions[slot];
+		slotPositions[slot] = -1;
+		if (position >= 0) {
+			Argument& arg = parsedArgs[position];
+			if (arg.values.empty()) {
+				RECORD_ERROR(specs.statsCommand(), STATS_ERROR_MISSING_REQUIRED_ARG);
+				CLIError error(CLI_ERROR_MISSING_VALUE);
+				specs.locate(error, (int)slot);
+				reportError(error);
+				return false;
 			}
+			// Values already have the declared type; parseArguments converted them.
+			slotPositions[slot] = (int)mergedArgs.size();
+			mergedArgs.push_back(std::move(arg));
+		}
+		else if (specs.hasDefault(slot)) {
+			slotPositions[slot] = (int)mergedArgs.size();
+			// Defaults are borrowed from the spec rather than copied.
+			mergedArgs.push_back(Argument(specs.name(slot), &arena));
+			if (!reserveRoom(mergedArgs.back().values))
+				return outOfMemory(specs);
+			mergedArgs.back().values.push_back(specs.defaultValue(slot));
+		}
+		else if (specs.required(slot)) {
+			RECORD_ERROR(specs.statsCommand(), STATS_ERROR_MISSING_REQUIRED_ARG);
+			CLIError error(CLI_ERROR_MISSING_REQUIRED_ARG);
+			specs.locate(error, (int)slot);
+			reportError(error);
+			return false;
+		}
+	}
+	return true;
+}
+
+template <class Specs>
+bool Dispatcher::outOfMemory(const Specs& specs) {
+	RECORD_ERROR(specs.statsCommand(), STATS_ERROR_OUT_OF_MEMORY);
+	CLIError error(CLI_ERROR_OUT_OF_MEMORY);
+	specs.locate(error);
+	reportError(error);
+	return false;
+}
+
+Dispatcher::Dispatcher()
+	: output(nullptr), table(0), tableSize(0), frozen(false), shared(0), dispatchDepth(0), input(0), journal(0),
+	replaying(false), batchEntry(0) {
+}
+
+Dispatcher::Dispatcher(const Dispatcher* source)
+	: output(source->output), errorCallback(source->errorCallback), errorHandler(source->errorHandler), table(0), tableSize(0),
+	frozen(true), shared(source), dispatchDepth(0), input(0), journal(0), replaying(false), batchEntry(0) {
+}
+
+void Dispatcher::registerOutput(CLIOutput* output) {
+	this->output = output;
+}
+
+bool Dispatcher::canRegister(const Command& cmd) {
+	if (frozen) {
+		CLIError error(CLI_ERROR_FROZEN);
+		error.command = &cmd;
+		reportError(error);
+		return false;
+	}
+	const std::string* clash = commandIndex.findClash(commands, cmd);
+	if (!clash)
+		return true;
+	CLIError error(clash == &cmd.name ? CLI_ERROR_DUPLICATE_NAME : CLI_ERROR_DUPLICATE_ALIAS);
+	error.command = &cmd;
+	error.name = clash->c_str();
+	reportError(error);
+	return false;
+}
+
+bool Dispatcher::registerCommand(const Command& cmd) {
+	if (!canRegister(cmd))
+		return false;
+	commands.push_back(cmd);
+	commandIndex.insert(commands, commands.size() - 1);
+	return true;
+}
+
+bool Dispatcher::registerCommand(Command&& cmd) {
+	if (!canRegister(cmd))
+		return false;
+	commands.push_back(std::move(cmd));
+	commandIndex.insert(commands, commands.size() - 1);
+	return true;
+}
+
+// Give cmd and its subtree ids in depth-first order. The tree no longer changes once frozen,
+// so the pointers stay valid.
+static void numberCommands(Command& cmd, std::vector<const Command*>& byId) {
+	cmd.id = (uint32_t)byId.size();
+	byId.push_back(&cmd);
+	for (size_t i = 0; i < cmd.subcommands.size(); i++) {
+		numberCommands(cmd.subcommands[i], byId);
+	}
+}
+
+void Dispatcher::freeze() {
+	commands.shrink_to_fit();
+	for (size_t i = 0; i < commands.size(); i++) {
+		commands[i].shrinkToFit();
+	}
+	commandIndex.shrinkToFit();
+	// Render help now, so that printing it never writes to the tree once it may be shared.
+	for (size_t i = 0; i < commands.size(); i++) {
+		commands[i].renderUsage();
+	}
+	commandsById.clear();
+	for (size_t i = 0; i < commands.size(); i++) {
+		numberCommands(commands[i], commandsById);
+	}
+	commandsById.shrink_to_fit();
+	frozen = true;
+}
+
+// Return the first entry in the subtree with more arguments than the slot bitmasks hold, if any.
+static const TableCommand* findOversizedEntry(const TableCommand* entries, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		if (entries[i].argCount > MAX_ARG_SPECS)
+			return &entries[i];
+		const TableCommand* found = findOversizedEntry(entries[i].subcommands, entries[i].subcommandCount);
+		if (found)
+			return found;
+	}
+	return 0;
+}
+
+bool Dispatcher::registerTable(const TableCommand* entries, size_t count) {
+	table = 0;
+	tableSize = 0;
+	const TableCommand* oversized = entries ? findOversizedEntry(entries, count) : 0;
+	if (oversized) {
+		CLIError error(CLI_ERROR_TOO_MANY_ARGS);
+		error.tableCommand = oversized;
+		reportError(error);
+		return false;
+	}
+	table = entries;
+	tableSize = entries ? count : 0;
+	return true;
+}
+
+const Command* Dispatcher::matchCommand(const TokenList& tokens, size_t& index) {
+	if (tokens.empty())
+		return 0;
+
+	const Dispatcher& source = tree();
+	int position = source.commandIndex.find(source.commands, tokens[0].data, tokens[0].length);
+	if (position < 0)
+		return 0;
+	const Command* current = &source.commands[position];
+	index = 1;
+	while (index < tokens.size() && !isFlagToken(tokens[index])) {
+		const Command* sub = current->findSubcommand(tokens[index].data, tokens[index].length);
+		if (!sub)
+			break;
+		current = sub;
+		index++;
+	}
+	return current;
+}
+
+const TableCommand* Dispatcher::matchTable(const TokenList& tokens, size_t& index) {
+	if (tokens.empty())
+		return 0;
+	const Dispatcher& source = tree();
+	const TableCommand* current = TableCommand::find(source.table, source.tableSize, tokens[0].data, tokens[0].length);
+	if (!current)
+		return 0;
+	index = 1;
+	while (index < tokens.size() && !isFlagToken(tokens[index])) {
+		const TableCommand* sub = current->findSubcommand(tokens[index].data, tokens[index].length);
+		if (!sub)
+			break;
+		current = sub;
+		index++;
+	}
+	return current;
+}
+
+template <class Specs>
+bool Dispatcher::parseArguments(const TokenList& tokens, size_t index, const Specs& specs,
+	ArgumentList& outArgs, SlotList& slotPositions, bool& help) {
+	uint64_t seenSlots = 0;
+	bool foundHelpShort = false, foundHelpLong = false;
+	while (index < tokens.size()) {
+		const Token& token = tokens[index];
+		if (!isFlagToken(token)) {
+			RECORD_ERROR(specs.statsCommand(), STATS_ERROR_UNEXPECTED_TOKEN);
+			CLIError error(CLI_ERROR_UNEXPECTED_TOKEN);
+			specs.locate(error);
+			locateToken(error, tokens, index);
+			reportError(error);
+			return false;
+		}
+		const char* argName = token.data + 1;
+		size_t argLength = token.length - 1;
+		index++;
+		bool isHelpShort = argLength == 1 && std::memcmp(argName, HELP_FLAG_SHORT, 1) == 0;
+		bool isHelpLong = argLength == 4 && std::memcmp(argName, HELP_FLAG_LONG, 4) == 0;
+		int slot = (isHelpShort || isHelpLong) ? -1 : specs.slot(argName, argLength);
+#ifdef USE_SUGGESTIONS
+		// A flag without a spec is an error, with suggestions attached, unless the command is variadic.
+		// Without suggestions such flags are ignored, as they always were.
+		if (slot < 0 && !isHelpShort && !isHelpLong && !specs.variadic()) {
+			RECORD_ERROR(specs.statsCommand(), STATS_ERROR_UNKNOWN_ARG);
+			CLIError error(CLI_ERROR_UNKNOWN_ARG);
+			specs.locate(error);
+			locateToken(error, tokens, index - 1);
+			specs.suggestArguments(argName, argLength, suggestions);
+			error.suggestions = &suggestions;
+			reportError(error);
+			suggestions.count = 0;
+			return false;
 		}
-		if (!found) {
-			if (spec.required && !spec.hasDefault) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-				reportError("Required argument missing: " + spec.name);
-#else
-				reportError(ERROR_CMD_MISSING_REQUIRED_ARG);
 #endif
+		bool duplicate = false;
+		if (isHelpShort) {
+			duplicate = foundHelpShort;
+			foundHelpShort = true;
+		}
+		else if (isHelpLong) {
+			duplicate = foundHelpLong;
+			foundHelpLong = true;
+		}
+		else if (slot >= 0) {
+			uint64_t bit = (uint64_t)1 << slot;
+			duplicate = (seenSlots & bit) != 0;
+			seenSlots |= bit;
+		}
+		if (duplicate) {
+			RECORD_ERROR(specs.statsCommand(), STATS_ERROR_DUPLICATE_NAME);
+			CLIError error(CLI_ERROR_DUPLICATE_ARG);
+			specs.locate(error, slot);
+			locateToken(error, tokens, index - 1);
+			reportError(error);
+			return false;
+		}
+		if (slot < 0) {
+			// Help flags, and flags without a spec on variadic commands, take no part in binding; skip their values.
+			while (index < tokens.size() && !isFlagToken(tokens[index]))
+				index++;
+			continue;
+		}
+		ValueType type = specs.type(slot);
+		if (!reserveRoom(outArgs))
+			return outOfMemory(specs);
+		slotPositions[slot] = (int)outArgs.size();
+		outArgs.push_back(Argument(specs.name(slot), &arena));
+		Argument& arg = outArgs.back();
+		while (index < tokens.size() && !isFlagToken(tokens[index])) {
+			Value value;
+			if (!parseTypedValue(tokens[index], type, value)) {
+				if (arena.hasOverflowed())
+					return outOfMemory(specs);
+				RECORD_ERROR(specs.statsCommand(), STATS_ERROR_TYPE_MISMATCH);
+				CLIError error(CLI_ERROR_TYPE_MISMATCH);
+				specs.locate(error, slot);
+				locateToken(error, tokens, index);
+				reportError(error);
 				return false;
 			}
-			if (spec.hasDefault) {
-				Argument defaultArg(spec.name);
-				defaultArg.values.push_back(spec.defaultValue);
-				mergedArgs.push_back(defaultArg);
-			}
+			if (!reserveRoom(arg.values))
+				return outOfMemory(specs);
+			arg.values.push_back(std::move(value));
+			index++;
 		}
 	}
-	Command execCmd = *cmd;
-	execCmd.arguments = mergedArgs;
-	if (execCmd.callback) {
-		execCmd.callback(execCmd);
+	if (foundHelpShort && foundHelpLong) {
+		RECORD_ERROR(specs.statsCommand(), STATS_ERROR_DUPLICATE_HELP_FLAG);
+		CLIError error(CLI_ERROR_DUPLICATE_HELP_FLAG);
+		specs.locate(error);
+		reportError(error);
+		return false;
+	}
+	help = foundHelpShort || foundHelpLong;
+	return true;
+}
+
+// The microbenchmarks call these stages directly with registered commands.
+template bool Dispatcher::parseArguments<Dispatcher::CommandSpecs>(const TokenList&, size_t, const CommandSpecs&,
+	ArgumentList&, SlotList&, bool&);
+template bool Dispatcher::bindArguments<Dispatcher::CommandSpecs>(const CommandSpecs&, ArgumentList&, SlotList&,
+	ArgumentList&);
+
+bool Dispatcher::parseTypedValue(const Token& token, ValueType type, Value& out) {
+	if (type == VAL_LIST)
+		return token.isList() && parseList(token, out);
+	const char* text = token.data;
+	size_t length = token.length;
+	if (token.isQuoted()) {
+		char* unquoted = static_cast<char*>(arena.allocate(token.length, 1));
+		if (!unquoted)
+			return false;
+		length = token.unquoteTo(unquoted);
+		text = unquoted;
+	}
+	Scalar scalar;
+	switch (type) {
+	case VAL_STRING:
+		// Any text is a valid string, including text that looks like a number.
+		out = Value(text, length, &arena);
+		return out.type == VAL_STRING;
+	case VAL_INT:
+		if (parseScalar(text, length, scalar) != SCALAR_INT)
+			return false;
+		out = Value(scalar.intValue);
 		return true;
+	case VAL_DOUBLE:
+		switch (parseScalar(text, length, scalar)) {
+		case SCALAR_INT:
+			out = Value((double)scalar.intValue);
+			return true;
+		case SCALAR_DOUBLE:
+			out = Value(scalar.doubleValue);
+			return true;
+		default:
+			return false;
+		}
+	case VAL_BOOL:
+		if (parseScalar(text, length, scalar) != SCALAR_BOOL)
+			return false;
+		out = Value(scalar.boolValue);
+		return true;
+	default:
+		if (token.isList())
+			return parseList(token, out);
+		out = parseValue(text, length);
+		return out.type != VAL_NONE;
 	}
-	else {
-#ifdef USE_DESCRIPTIVE_ERRORS
-		reportError("No callback defined for command: " + execCmd.name);
-#else
-		reportError(ERROR_CMD_NO_CALLBACK);
-#endif
-		return false;
+}
+
+Value Dispatcher::parseValue(const Token& token) {
+	if (token.isQuoted()) {
+		char* text = static_cast<char*>(arena.allocate(token.length, 1));
+		if (!text)
+			return Value();
+		return parseValue(text, token.unquoteTo(text));
 	}
+	return parseValue(token.data, token.length);
 }
 
-enum TokenizerState { TS_OUTSIDE, TS_IN_QUOTE, TS_IN_ESCAPE, TS_IN_LIST };
+Value Dispatcher::parseValue(const char* token, size_t length) {
+	Scalar scalar;
+	switch (parseScalar(token, length, scalar)) {
+	case SCALAR_INT:
+		return Value(scalar.intValue);
+	case SCALAR_DOUBLE:
+		return Value(scalar.doubleValue);
+	case SCALAR_BOOL:
+		return Value(scalar.boolValue);
+	default:
+		return Value(token, length, &arena);
+	}
+}
 
-static bool isFlagToken(const std::string& token) {
-	if (token.empty())
+// A list token is unquoted as a whole only when it is read here, so its text still holds the
+// quotes and escapes of its items.
+bool Dispatcher::parseList(const Token& token, Value& out) {
+	Token list = Lexer::trim(token);
+	size_t position = 0;
+	if (list.length == 0 || list.data[0] != LIST_START)
 		return false;
-	if (token[0] != DASH_CHAR)
+	return parseListAt(list.data, list.length, position, 0, out) && position == list.length;
+}
+
+// Recursive descent over list := '[' (item | list)? (',' (item | list)?)* ']'. Empty items are
+// skipped, and every character is looked at once, so parsing is linear in the length of the list.
+bool Dispatcher::parseListAt(const char* text, size_t length, size_t& position, unsigned depth, Value& out) {
+	if (depth >= LIST_MAX_DEPTH)
 		return false;
-	if (token.size() == 1)
+	out = Value::list(0, &arena);
+	position++;
+	while (true) {
+		while (position < length && std::isspace((unsigned char)text[position]))
+			position++;
+		if (position == length)
+			return false;
+		char c = text[position];
+		if (c == LIST_END) {
+			position++;
+			return true;
+		}
+		if (c == DELIMITER_CHAR) {
+			position++;
+			continue;
+		}
+		if (c == LIST_START) {
+			Value item;
+			if (!parseListAt(text, length, position, depth + 1, item))
+				return false;
+			if (!out.append(std::move(item), &arena))
+				return false;
+			while (position < length && std::isspace((unsigned char)text[position]))
+				position++;
+		}
+		else if (!parseListItem(text, length, position, out)) {
+			return false;
+		}
+		// An item is followed by the next one or the end of its list, not by another list.
+		if (position < length && text[position] != DELIMITER_CHAR && text[position] != LIST_END)
+			return false;
+	}
+}
+
+bool Dispatcher::parseListItem(const char* text, size_t length, size_t& position, Value& list) {
+	size_t begin = position;
+	bool inQuote = false, escaped = false, hasEscape = false;
+	for (; position < length; position++) {
+		char c = text[position];
+		if (escaped) {
+			escaped = false;
+		}
+		else if (c == ESCAPE_CHAR) {
+			escaped = true;
+			hasEscape = true;
+		}
+		else if (c == QUOTE_CHAR) {
+			inQuote = !inQuote;
+		}
+		else if (!inQuote && (c == DELIMITER_CHAR || c == LIST_END || c == LIST_START)) {
+			break;
+		}
+	}
+	Token item = Lexer::trim(Token(text + begin, position - begin));
+	if (item.length == 0)
 		return true;
-	if (std::isdigit(token[1]) || token[1] == DECIMAL_POINT)
+	if (item.length >= 2 && item.data[0] == QUOTE_CHAR && item.data[item.length - 1] == QUOTE_CHAR) {
+		item = Token(item.data + 1, item.length - 2);
+	}
+	if (!hasEscape) {
+		Value value = parseValue(item.data, item.length);
+		return value.type != VAL_NONE && list.append(std::move(value), &arena);
+	}
+	char* unescaped = static_cast<char*>(arena.allocate(item.length, 1));
+	if (!unescaped)
 		return false;
-	return true;
+	size_t n = 0;
+	for (size_t k = 0; k < item.length; k++) {
+		if (item.data[k] == ESCAPE_CHAR && k + 1 < item.length)
+			k++;
+		unescaped[n++] = item.data[k];
+	}
+	Value value = parseValue(unescaped, n);
+	return value.type != VAL_NONE && list.append(std::move(value), &arena);
 }
 
-static std::vector<std::string> splitListItems(const std::string& input) {
-	std::vector<std::string> items;
-	std::string current;
-	enum { ST_OUT, ST_IN_QUOTE, ST_IN_ESCAPE } state = ST_OUT;
-	for (size_t i = 0; i < input.size(); i++) {
-		char c = input[i];
-		switch (state) {
-		case ST_OUT:
-			if (c == ESCAPE_CHAR) {
-				state = ST_IN_ESCAPE;
-			}
-			else if (c == QUOTE_CHAR) {
-				state = ST_IN_QUOTE;
-				current.push_back(c);
-			}
-			else if (c == DELIMITER_CHAR) {
-				items.push_back(current);
-				current.clear();
-			}
-			else {
-				current.push_back(c);
-			}
-			break;
-		case ST_IN_QUOTE:
-			if (c == ESCAPE_CHAR) {
-				state = ST_IN_ESCAPE;
-				current.push_back(c);
-			}
-			else if (c == QUOTE_CHAR) {
-				state = ST_OUT;
-				current.push_back(c);
-			}
-			else {
-				current.push_back(c);
-			}
-			break;
-		case ST_IN_ESCAPE:
-			current.push_back(c);
-			state = ST_IN_QUOTE;
-			break;
+bool Dispatcher::dispatch(const std::string& input) {
+	return dispatch(input.data(), input.size());
+}
+
+bool Dispatcher::dispatch(const char* input, size_t length) {
+	DispatchScope scope(*this);
+	InputScope text(*this, input);
+#ifdef RAPTORCLI_EXCEPTIONS
+	try {
+#endif
+		TokenList commandSpans((ArenaAllocator<Token>(&arena)));
+		if (!Lexer::splitCommands(input, length, commandSpans)) {
+			RECORD_ERROR(0, STATS_ERROR_OUT_OF_MEMORY);
+			reportError(CLIError(CLI_ERROR_OUT_OF_MEMORY));
+			return false;
+		}
+		bool overallSuccess = true;
+		for (size_t i = 0; i < commandSpans.size(); i++) {
+			bool result = dispatchSingleCommand(commandSpans[i]);
+			if (!result)
+				overallSuccess = false;
 		}
+		return overallSuccess;
+#ifdef RAPTORCLI_EXCEPTIONS
 	}
-	if (!current.empty()) {
-		items.push_back(current);
+	catch (const std::bad_alloc&) {
+		RECORD_ERROR(0, STATS_ERROR_OUT_OF_MEMORY);
+		reportError(CLIError(CLI_ERROR_OUT_OF_MEMORY));
+		return false;
 	}
-	return items;
+#endif
 }
 
-Dispatcher::Dispatcher() {
-	gDispatcher = this;
+void Dispatcher::dispatchBatchEntry(const char* input, size_t length, std::vector<DispatchResult>& results) {
+	results.push_back(DispatchResult());
+	DispatchResult& entry = results.back();
+	entry.error = 0;
+	entry.code = CLI_ERROR_NONE;
+	entry.offset = CLI_ERROR_NO_POSITION;
+	BatchScope scope(*this, entry);
+	entry.success = dispatch(input, length);
 }
 
-void Dispatcher::registerOutput(CLIOutput* output) {
-	this->output = output;
+size_t Dispatcher::dispatchBatch(const std::vector<std::string>& lines, std::vector<DispatchResult>& results) {
+	results.clear();
+	results.reserve(lines.size());
+	batchMessages.clear();
+	size_t succeeded = 0;
+	for (size_t i = 0; i < lines.size(); i++) {
+		dispatchBatchEntry(lines[i].data(), lines[i].size(), results);
+		if (results.back().success)
+			succeeded++;
+	}
+	return succeeded;
 }
 
-bool Dispatcher::registerCommand(const Command& cmd) {
-	for (size_t i = 0; i < commands.size(); i++) {
-		if (commands[i].name == cmd.name) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-			reportError("Duplicate command name: " + cmd.name);
-#else
-			reportError(ERROR_CMD_DUPLICATE_NAME);
+size_t Dispatcher::dispatchBatch(const char* input, size_t length, std::vector<DispatchResult>& results) {
+	results.clear();
+	batchMessages.clear();
+	size_t succeeded = 0;
+	size_t begin = 0;
+	// A trailing newline does not start another entry.
+	while (begin < length) {
+		const char* end = static_cast<const char*>(std::memchr(input + begin, '\n', length - begin));
+		size_t lineEnd = end ? (size_t)(end - input) : length;
+		dispatchBatchEntry(input + begin, lineEnd - begin, results);
+		if (results.back().success)
+			succeeded++;
+		begin = lineEnd + 1;
+	}
+	return succeeded;
+}
+
+// Check a decoded value against the declared type, widening ints to doubles as text input does.
+static bool fitWireValue(Value& value, ValueType type) {
+	if (type == VAL_NONE || value.type == type)
+		return true;
+	if (type == VAL_DOUBLE && value.type == VAL_INT) {
+		value = Value((double)value.intValue);
+		return true;
+	}
+	return false;
+}
+
+bool Dispatcher::dispatchFrame(const uint8_t* frame, size_t length) {
+	DispatchScope scope(*this);
+#ifdef RAPTORCLI_EXCEPTIONS
+	try {
 #endif
+		WireReader reader(frame, length);
+		uint8_t version;
+		if (!reader.byte(version) || version != WIRE_VERSION) {
+			RECORD_ERROR(0, STATS_ERROR_MALFORMED_FRAME);
+			CLIError error(CLI_ERROR_FRAME_VERSION);
+			error.offset = 0;
+			reportError(error);
 			return false;
 		}
-		for (size_t j = 0; j < cmd.aliases.size(); j++) {
-			if (commands[i].name == cmd.aliases[j]) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-				reportError("Duplicate command alias: " + cmd.aliases[j]);
-#else
-				reportError(ERROR_CMD_DUPLICATE_ALIAS);
+		bool overallSuccess = true;
+		bool intact = true;
+		while (intact && !reader.atEnd()) {
+			if (!dispatchWireCommand(reader, intact))
+				overallSuccess = false;
+		}
+		return overallSuccess;
+#ifdef RAPTORCLI_EXCEPTIONS
+	}
+	catch (const std::bad_alloc&) {
+		RECORD_ERROR(0, STATS_ERROR_OUT_OF_MEMORY);
+		reportError(CLIError(CLI_ERROR_OUT_OF_MEMORY));
+		return false;
+	}
 #endif
-				return false;
-			}
-			for (size_t k = 0; k < commands[i].aliases.size(); k++) {
-				if (commands[i].aliases[k] == cmd.aliases[j]) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-					reportError("Duplicate command alias: " + cmd.aliases[j]);
+}
+
+bool Dispatcher::dispatchWireCommand(WireReader& reader, bool& intact) {
+#ifdef USE_COMMAND_STATS
+	uint32_t started = statsClock();
+	stats.dispatches++;
 #else
-					reportError(ERROR_CMD_DUPLICATE_ALIAS);
+	uint32_t started = 0;
 #endif
-					return false;
-				}
-			}
+	const Dispatcher& source = tree();
+	size_t commandStart = reader.getPosition();
+	uint32_t id;
+	if (!reader.varint(id)) {
+		intact = false;
+		RECORD_ERROR(0, STATS_ERROR_MALFORMED_FRAME);
+		CLIError error(CLI_ERROR_MALFORMED_FRAME);
+		error.offset = reader.getPosition();
+		reportError(error);
+		return false;
+	}
+	if (id >= source.commandsById.size()) {
+		// The sender's tree differs from ours, so nothing after this command can be decoded.
+		intact = false;
+		RECORD_ERROR(0, STATS_ERROR_UNKNOWN_COMMAND);
+		CLIError error(CLI_ERROR_UNKNOWN_COMMAND_ID);
+		error.offset = commandStart;
+		error.commandId = id;
+		reportError(error);
+		return false;
+	}
+	CommandSpecs specs(*source.commandsById[id], shared != 0);
+#ifdef USE_COMMAND_STATS
+	if (specs.statsCommand())
+		specs.statsCommand()->stats.dispatches++;
+#endif
+	arena.clearOverflow();
+	ArgumentList parsedArgs((ArenaAllocator<Argument>(&arena)));
+	SlotList slotPositions((ArenaAllocator<int>(&arena)));
+	if (!reserveRoom(slotPositions, specs.count())) {
+		intact = false;
+		return outOfMemory(specs);
+	}
+	slotPositions.assign(specs.count(), -1);
+	if (!decodeWireArguments(reader, specs, parsedArgs, slotPositions, intact)) {
+		// Running out of arena mid-command leaves the reader out of step, like a malformed frame.
+		if (arena.hasOverflowed())
+			return outOfMemory(specs);
+		if (!intact) {
+			RECORD_ERROR(specs.statsCommand(), STATS_ERROR_MALFORMED_FRAME);
+			CLIError error(CLI_ERROR_MALFORMED_FRAME);
+			specs.locate(error);
+			error.offset = reader.getPosition();
+			reportError(error);
 		}
+		return false;
 	}
-	commands.push_back(cmd);
-	return true;
+	return invokeParsed(specs, parsedArgs, slotPositions, started);
 }
 
-std::vector<std::string> Dispatcher::tokenize(const std::string& input) {
-	std::vector<std::string> tokens;
-	std::string token;
-	TokenizerState state = TS_OUTSIDE;
-	for (size_t i = 0; i < input.size(); i++) {
-		char c = input[i];
-		switch (state) {
-		case TS_OUTSIDE:
-			if (isspace(c)) {
-				if (!token.empty()) {
-					tokens.push_back(trim(token));
-					token.clear();
-				}
-			}
-			else if (c == QUOTE_CHAR) {
-				state = TS_IN_QUOTE;
-			}
-			else if (c == LIST_START) {
-				state = TS_IN_LIST;
-				token.push_back(c);
-			}
-			else {
-				token.push_back(c);
+// The first duplicate or mistyped argument is reported, and the rest of the command is still read
+// so that the next command of the frame can run.
+bool Dispatcher::decodeWireArguments(WireReader& reader, const CommandSpecs& specs, ArgumentList& outArgs,
+	SlotList& slotPositions, bool& intact) {
+	uint32_t argCount;
+	if (!reader.varint(argCount)) {
+		intact = false;
+		return false;
+	}
+	uint64_t seenSlots = 0;
+	bool valid = true;
+	for (uint32_t i = 0; i < argCount; i++) {
+		uint32_t header, valueCount = 1;
+		if (!reader.varint(header) || ((header & 1) && !reader.varint(valueCount)) || (header >> 1) >= specs.count()) {
+			intact = false;
+			return false;
+		}
+		size_t slot = header >> 1;
+		uint64_t bit = (uint64_t)1 << slot;
+		Argument* arg = 0;
+		if (seenSlots & bit) {
+			if (valid) {
+				RECORD_ERROR(specs.statsCommand(), STATS_ERROR_DUPLICATE_NAME);
+				CLIError error(CLI_ERROR_DUPLICATE_ARG);
+				specs.locate(error, (int)slot);
+				error.offset = reader.getPosition();
+				reportError(error);
 			}
-			break;
-		case TS_IN_QUOTE:
-			if (c == ESCAPE_CHAR) {
-				state = TS_IN_ESCAPE;
+			valid = false;
+		}
+		else if (valid) {
+			if (!reserveRoom(outArgs)) {
+				intact = false;
+				return false;
 			}
-			else if (c == QUOTE_CHAR) {
-				state = TS_OUTSIDE;
-				break;
+			seenSlots |= bit;
+			slotPositions[slot] = (int)outArgs.size();
+			outArgs.push_back(Argument(specs.name(slot), &arena));
+			arg = &outArgs.back();
+		}
+		// Every value takes at least a byte, so a bogus count runs out of input instead of looping.
+		for (uint32_t v = 0; v < valueCount; v++) {
+			Value value;
+			if (!reader.value(value, &arena)) {
+				intact = false;
+				return false;
 			}
-			else {
-				token.push_back(c);
+			if (!arg)
+				continue;
+			if (!fitWireValue(value, specs.type(slot))) {
+				RECORD_ERROR(specs.statsCommand(), STATS_ERROR_TYPE_MISMATCH);
+				CLIError error(CLI_ERROR_TYPE_MISMATCH);
+				specs.locate(error, (int)slot);
+				error.offset = reader.getPosition();
+				reportError(error);
+				valid = false;
+				arg = 0;
+				continue;
 			}
-			break;
-		case TS_IN_ESCAPE:
-			token.push_back(c);
-			state = TS_IN_QUOTE;
-			break;
-		case TS_IN_LIST:
-			token.push_back(c);
-			if (c == LIST_END) {
-				state = TS_OUTSIDE;
+			if (!reserveRoom(arg->values)) {
+				intact = false;
+				return false;
 			}
-			break;
+			arg->values.push_back(std::move(value));
 		}
 	}
-	if (!token.empty()) {
-		tokens.push_back(trim(token));
+	return valid;
+}
+
+size_t Dispatcher::replay(const CommandJournal& source) {
+	bool wasReplaying = replaying;
+	replaying = true;
+	size_t succeeded = 0;
+	size_t offset = source.begin();
+	const uint8_t* record;
+	size_t length;
+	while (source.next(offset, record, length)) {
+		if (replayRecord(record, length))
+			succeeded++;
 	}
-	return tokens;
+	replaying = wasReplaying;
+	return succeeded;
 }
 
-const Command* Dispatcher::matchCommand(const std::vector<std::string>& tokens, size_t& index) {
-	if (tokens.empty())
-		return 0;
+// Each record is a dispatch of its own, so the arena is released between records.
+bool Dispatcher::replayRecord(const uint8_t* record, size_t length) {
+	DispatchScope scope(*this);
+#ifdef RAPTORCLI_EXCEPTIONS
+	try {
+#endif
+		WireReader reader(record, length);
+		bool intact = true;
+		return dispatchWireCommand(reader, intact) && reader.atEnd();
+#ifdef RAPTORCLI_EXCEPTIONS
+	}
+	catch (const std::bad_alloc&) {
+		RECORD_ERROR(0, STATS_ERROR_OUT_OF_MEMORY);
+		reportError(CLIError(CLI_ERROR_OUT_OF_MEMORY));
+		return false;
+	}
+#endif
+}
+
+void Dispatcher::setArenaBuffer(void* buffer, size_t size) {
+	arena.setBuffer(buffer, size);
+}
 
+#ifdef USE_COMMAND_STATS
+void Dispatcher::recordError(const Command* cmd, StatsError error) {
+	if (cmd)
+		cmd->stats.errors[error]++;
+	stats.errors[error]++;
+}
+
+static void resetCommandStats(const Command& cmd) {
+	cmd.stats.reset();
+	for (size_t i = 0; i < cmd.subcommands.size(); i++) {
+		resetCommandStats(cmd.subcommands[i]);
+	}
+}
+
+void Dispatcher::resetStats() {
+	stats.reset();
 	for (size_t i = 0; i < commands.size(); i++) {
-		if (commands[i].name == tokens[0]) {
-			const Command* current = &commands[i];
-			index = 1;
-			while (index < tokens.size() && tokens[index][0] != DASH_CHAR) {
-				bool foundSub = false;
-				for (size_t j = 0; j < current->subcommands.size(); j++) {
-					if (current->subcommands[j].name == tokens[index]) {
-						current = &current->subcommands[j];
-						foundSub = true;
-						index++;
-						break;
-					}
-					for (size_t k = 0; k < current->subcommands[j].aliases.size(); k++) {
-						if (current->subcommands[j].aliases[k] == tokens[index]) {
-							current = &current->subcommands[j];
-							foundSub = true;
-							index++;
-							break;
-						}
-					}
-					if (foundSub)
-						break;
-				}
-				if (!foundSub)
-					break;
-			}
-			return current;
-		}
-		for (size_t j = 0; j < commands[i].aliases.size(); j++) {
-			if (commands[i].aliases[j] == tokens[0]) {
-				const Command* current = &commands[i];
-				index = 1;
-				while (index < tokens.size() && tokens[index][0] != DASH_CHAR) {
-					bool foundSub = false;
-					for (size_t k = 0; k < current->subcommands.size(); k++) {
-						if (current->subcommands[k].name == tokens[index]) {
-							current = &current->subcommands[k];
-							foundSub = true;
-							index++;
-							break;
-						}
-						for (size_t l = 0; l < current->subcommands[k].aliases.size(); l++) {
-							if (current->subcommands[k].aliases[l] == tokens[index]) {
-								current = &current->subcommands[k];
-								foundSub = true;
-								index++;
-								break;
-							}
-						}
-						if (foundSub)
-							break;
-					}
-					if (!foundSub)
-						break;
-				}
-				return current;
-			}
-		}
+		resetCommandStats(commands[i]);
 	}
-	return 0;
 }
 
-bool Dispatcher::parseArguments(const std::vector<std::string>& tokens, size_t index, std::vector<Argument>& outArgs) {
-	std::set<std::string> seenArgs;
-	while (index < tokens.size()) {
-		std::string token = tokens[index];
-		if (token.empty() || !isFlagToken(token)) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-			reportError("Unexpected token: " + token);
+// Format a histogram bucket bound as e.g. "512ns", "2us" or "16ms".
+static void formatLatency(uint32_t ns, char* out) {
+	if (ns < 1000)
+		std::sprintf(out, "%luns", (unsigned long)ns);
+	else if (ns < 1000000)
+		std::sprintf(out, "%luus", (unsigned long)(ns / 1000));
+	else
+		std::sprintf(out, "%lums", (unsigned long)(ns / 1000000));
+}
+
+static void printStatsLine(CLIOutput* out, const std::string& label, const CommandStats& s) {
+	char line[160];
+	std::sprintf(line, "%lu dispatches, %lu errors", (unsigned long)s.dispatches, (unsigned long)s.errorCount());
+	std::string text = label + ": " + line;
+	const LatencyHistogram* histograms[] = { &s.parse, &s.callback };
+	const char* names[] = { "parse", "callback" };
+	for (size_t i = 0; i < 2; i++) {
+		if (histograms[i]->count == 0)
+			continue;
+		char p50[16], p99[16];
+		formatLatency(histograms[i]->percentile(50), p50);
+		formatLatency(histograms[i]->percentile(99), p99);
+		std::sprintf(line, ", %s p50 <%s p99 <%s", names[i], p50, p99);
+		text += line;
+	}
+	out->println(text);
+	for (unsigned e = 0; e < STATS_ERROR_COUNT; e++) {
+		if (s.errors[e] == 0)
+			continue;
+		std::sprintf(line, "  %s: %lu", statsErrorCode((StatsError)e), (unsigned long)s.errors[e]);
+		out->println(line);
+	}
+}
+
+static void printCommandStats(CLIOutput* out, const std::string& prefix, const Command& cmd) {
+	std::string path = prefix + cmd.name;
+	if (cmd.stats.dispatches > 0)
+		printStatsLine(out, path, cmd.stats);
+	for (size_t i = 0; i < cmd.subcommands.size(); i++) {
+		printCommandStats(out, path + " ", cmd.subcommands[i]);
+	}
+}
+
+void Dispatcher::printStats(CLIOutput* out) const {
+#ifdef ARDUINO
+	ArduinoCLIOutput fallback;
 #else
-			reportError(ERROR_CMD_UNEXPECTED_TOKEN);
+	StdCLIOutput fallback;
 #endif
-			return false;
-		}
-		std::string argName = token.substr(1);
-		if (seenArgs.find(argName) != seenArgs.end()) {
-#ifdef USE_DESCRIPTIVE_ERRORS
-			reportError("Duplicate argument: " + argName);
-#else
-			reportError(ERROR_CMD_DUPLICATE_NAME);
+	CLIOutput* target = out ? out : (output ? output : &fallback);
+	printStatsLine(target, "total", stats);
+	for (size_t i = 0; i < commands.size(); i++) {
+		printCommandStats(target, "", commands[i]);
+	}
+	target->flush();
+}
+
+static void statsCommandCallback(const Invocation& inv) {
+	if (!inv.dispatcher)
+		return;
+	if (inv.getBool(STATS_COMMAND_RESET_SLOT))
+		inv.dispatcher->resetStats();
+	else
+		inv.dispatcher->printStats(inv.output);
+}
+
+bool Dispatcher::registerStatsCommand(const std::string& name) {
+	Command cmd(name, "Prints dispatch statistics");
+	cmd.invocationCallback = statsCommandCallback;
+	cmd.addArgSpec(ArgSpec("reset", VAL_BOOL, false, Value(false), "Clear all counters instead"));
+	return registerCommand(std::move(cmd));
+}
 #endif
-			return false;
+
+void Dispatcher::printGlobalHelp() const {
+	const Dispatcher& source = tree();
+	if (!output) {
+		for (size_t i = 0; i < source.commands.size(); i++) {
+			source.commands[i].printUsage("  ", output);
 		}
-		seenArgs.insert(argName);
-		Argument arg(argName);
-		index++;
-		while (index < tokens.size() && !isFlagToken(tokens[index])) {
-			std::string valueToken = tokens[index];
-			if (!valueToken.empty() && valueToken[0] == LIST_START) {
-				arg.values.push_back(parseList(valueToken));
-			}
-			else {
-				arg.values.push_back(parseValue(valueToken));
-			}
-			index++;
+		for (size_t i = 0; i < source.tableSize; i++) {
+			source.table[i].printUsage("  ", output);
 		}
-		outArgs.push_back(arg);
+		return;
 	}
-	return true;
+	printHelp();
 }
 
-Value Dispatcher::parseValue(const std::string& token) {
-	char* endptr = 0;
-	long intValue = std::strtol(token.c_str(), &endptr, 10);
-	if (endptr != token.c_str() && *endptr == NULL_CHAR) {
-		return Value((int)intValue);
-	}
-	double doubleValue = std::strtod(token.c_str(), &endptr);
-	if (endptr != token.c_str() && *endptr == NULL_CHAR) {
-		return Value(doubleValue);
-	}
-	if (token == "true")
-		return Value(true);
-	else if (token == "false")
-		return Value(false);
-	return Value(token);
-}
-
-Value Dispatcher::parseList(const std::string& token) {
-	std::vector<Value> listValues;
-	if (token.size() >= 2 && token[0] == LIST_START && token[token.size() - 1] == LIST_END) {
-		std::string inner = token.substr(1, token.size() - 2);
-		std::vector<std::string> items = splitListItems(inner);
-		for (size_t i = 0; i < items.size(); i++) {
-			std::string item = items[i];
-			size_t start = 0;
-			while (start < item.size() && isspace(item[start]))
-				start++;
-			size_t end = item.size();
-			while (end > start && isspace(item[end - 1]))
-				end--;
-			std::string trimmed = item.substr(start, end - start);
-			if (!trimmed.empty()) {
-				if (trimmed[0] == QUOTE_CHAR && trimmed[trimmed.size() - 1] == QUOTE_CHAR) {
-					trimmed = trimmed.substr(1, trimmed.size() - 2);
-				}
-				listValues.push_back(parseValue(trimmed));
-			}
-		}
+// Split the next space-separated word off path; returns false when there is none left.
+static bool nextPathWord(const char*& path, const char*& word, size_t& length) {
+	while (*path == ' ')
+		path++;
+	word = path;
+	while (*path && *path != ' ')
+		path++;
+	length = (size_t)(path - word);
+	return length > 0;
+}
+
+const Command* Dispatcher::findCommand(const char* path) const {
+	const Dispatcher& source = tree();
+	const char* word;
+	size_t length;
+	if (!nextPathWord(path, word, length))
+		return 0;
+	int position = source.commandIndex.find(source.commands, word, length);
+	const Command* cmd = position < 0 ? 0 : &source.commands[position];
+	while (cmd && nextPathWord(path, word, length)) {
+		cmd = cmd->findSubcommand(word, length);
 	}
-	return Value(listValues);
+	return cmd;
 }
 
-bool Dispatcher::dispatch(const std::string& input) {
-	std::string cleanedInput = trim(input);
-	std::vector<std::string> commandStrings = splitCommands(cleanedInput);
-	bool overallSuccess = true;
-	for (const auto& cmdStr : commandStrings) {
-		std::string trimmedCmd = trim(cmdStr);
-		if (trimmedCmd.empty())
-			continue;
-		bool result = dispatchSingleCommand(trimmedCmd);
-		if (!result)
-			overallSuccess = false;
+size_t Dispatcher::printHelp(const char* path, size_t offset, size_t limit, CLIOutput* out) const {
+#ifdef ARDUINO
+	ArduinoCLIOutput fallback;
+#else
+	StdCLIOutput fallback;
+#endif
+	CLIOutput* target = out ? out : (output ? output : &fallback);
+	HelpWriter writer(target, offset, limit);
+	const Dispatcher& source = tree();
+	const char* word;
+	size_t length;
+	if (!nextPathWord(path, word, length)) {
+		for (size_t i = 0; i < source.commands.size(); i++) {
+			source.commands[i].writeUsage(writer, HELP_GLOBAL_INDENT);
+		}
+		for (size_t i = 0; i < source.tableSize; i++) {
+			source.table[i].writeUsage(writer, HELP_GLOBAL_INDENT);
+		}
+	}
+	else {
+		// Registered commands shadow table entries of the same name, as in matchCommand.
+		const Command* cmd = 0;
+		const TableCommand* entry = 0;
+		int position = source.commandIndex.find(source.commands, word, length);
+		if (position >= 0)
+			cmd = &source.commands[position];
+		else
+			entry = TableCommand::find(source.table, source.tableSize, word, length);
+		while ((cmd || entry) && nextPathWord(path, word, length)) {
+			if (cmd)
+				cmd = cmd->findSubcommand(word, length);
+			else
+				entry = entry->findSubcommand(word, length);
+		}
+		if (cmd)
+			cmd->writeUsage(writer);
+		else if (entry)
+			entry->writeUsage(writer);
 	}
-	return overallSuccess;
+	target->flush();
+	return writer.getLines();
 }
 
-void Dispatcher::printGlobalHelp() const {
-	for (size_t i = 0; i < commands.size(); i++) {
-		commands[i].printUsage("  ", output);
+static void helpCommandCallback(const Invocation& inv) {
+	if (!inv.dispatcher)
+		return;
+	const char* path = inv.getString(HELP_COMMAND_PATH_SLOT);
+	int page = inv.getInt(HELP_COMMAND_PAGE_SLOT);
+	int lines = inv.getInt(HELP_COMMAND_LINES_SLOT);
+	CLIOutput* out = inv.output ? inv.output : inv.dispatcher->getOutput();
+	if (page < 1 || lines < 0) {
+		if (out)
+			out->println("Invalid page or line count");
+		return;
+	}
+	size_t limit = (size_t)lines;
+	size_t total = inv.dispatcher->printHelp(path, (size_t)(page - 1) * limit, limit, out);
+	if (!out)
+		return;
+	if (total == 0) {
+		out->println(std::string("No such command: ") + path);
+	}
+	else if (limit > 0 && total > limit) {
+		char footer[48];
+		std::sprintf(footer, "-- page %d of %lu --", page, (unsigned long)((total + limit - 1) / limit));
+		out->println(footer);
 	}
 }
 
+bool Dispatcher::registerHelpCommand(const std::string& name) {
+	Command cmd(name, "Prints help for all commands or one command");
+	cmd.invocationCallback = helpCommandCallback;
+	cmd.addArgSpec(ArgSpec("command", VAL_STRING, false, Value(""), "Command path, e.g. \"net wifi\""));
+	cmd.addArgSpec(ArgSpec("page", VAL_INT, false, Value(1), "Page to print, starting at 1"));
+	cmd.addArgSpec(ArgSpec("lines", VAL_INT, false, Value(HELP_PAGE_LINES), "Lines per page, 0 for all"));
+	return registerCommand(std::move(cmd));
+}
+
 CLIOutput* Dispatcher::getOutput() {
 	return output;
 }
@@ -1,59 +1,106 @@
 // src/executable_command.cpp
 #include "executable_command.h"
 #include "clioutput.h"
+#include "scalar_parser.h"
+
+// Stands in for the base command of a default-constructed ExecutableCommand.
+static const Command& noCommand() {
+	static const Command empty;
+	return empty;
+}
 
 ExecutableCommand::ExecutableCommand(const Command& baseCmd, const std::vector<Argument>& presetArgs)
-	: baseCommand(baseCmd), presetArgs(presetArgs) {
+	: baseCommand(&baseCmd), presetArgs(presetArgs.begin(), presetArgs.end()) {
+	bindSlots();
 }
 
 ExecutableCommand::ExecutableCommand(const Command& baseCmd, std::initializer_list<std::pair<std::string, Value>> presetArgsList)
-	: baseCommand(baseCmd) {
+	: baseCommand(&baseCmd) {
+	presetArgs.reserve(presetArgsList.size());
 	for (const auto& p : presetArgsList) {
-		Argument arg(p.first);
-		arg.values.push_back(p.second);
-		presetArgs.push_back(arg);
+		presetArgs.push_back(Argument(p.first));
+		presetArgs.back().values.push_back(p.second);
 	}
+	bindSlots();
 }
 
-bool ExecutableCommand::execute() const {
-	if (baseCommand.callback) {
-		Command execCmd = baseCommand;
-		execCmd.arguments = presetArgs;
-		execCmd.callback(execCmd);
-		return true;
+ExecutableCommand::ExecutableCommand(const ExecutableCommand& other)
+	: baseCommand(other.baseCommand), presetArgs(other.presetArgs.begin(), other.presetArgs.end()) {
+	bindSlots();
+}
+
+ExecutableCommand& ExecutableCommand::operator=(const ExecutableCommand& other) {
+	if (this != &other) {
+		baseCommand = other.baseCommand;
+		presetArgs.assign(other.presetArgs.begin(), other.presetArgs.end());
+		bindSlots();
 	}
-	else {
-		CLIOutput* out = baseCommand.getOutput();
-		if (out) {
-			out->println("Error: No callback defined for command: " + baseCommand.name);
+	return *this;
+}
+
+// Preset names come from the caller, so each is pointed at its ArgSpec's name, or at a copy
+// kept here if the base command has no spec for it.
+void ExecutableCommand::bindSlots() {
+	slotPositions.assign(baseCommand ? baseCommand->argSpecs.size() : 0, -1);
+	std::vector<std::string> names;
+	names.reserve(presetArgs.size());
+	for (size_t i = 0; i < presetArgs.size(); i++) {
+		Argument& arg = presetArgs[i];
+		int slot = baseCommand ? baseCommand->argSlot(arg.name.text, arg.name.length) : -1;
+		if (slot >= 0) {
+			arg.name = ArgumentName(baseCommand->argSpecs[slot].name);
 		}
-		return false;
+		else {
+			names.push_back(arg.name.str());
+			arg.name = ArgumentName(names.back());
+		}
+		if (slot >= 0 && slotPositions[slot] < 0)
+			slotPositions[slot] = (int)i;
 	}
+	unslottedNames.swap(names);
 }
 
-bool ExecutableCommand::executeWithArgs(std::initializer_list<std::pair<std::string, Value>> argsList) const {
-	std::vector<Argument> args;
-	for (const auto& p : argsList) {
-		Argument arg(p.first);
-		arg.values.push_back(p.second);
-		args.push_back(arg);
-	}
-	if (baseCommand.callback) {
-		Command execCmd = baseCommand;
-		execCmd.arguments = args;
-		execCmd.callback(execCmd);
+bool ExecutableCommand::invoke(ArgumentList& args, const int* slots) const {
+	const Command& cmd = getBaseCommand();
+	if (cmd.invoke(args, cmd.getOutput(), slots)) {
 		return true;
 	}
 	else {
-		CLIOutput* out = baseCommand.getOutput();
+		CLIOutput* out = cmd.getOutput();
 		if (out) {
-			out->println("Error: No callback defined for command: " + baseCommand.name);
+			out->println("Error: No callback defined for command: " + cmd.name);
 		}
 		return false;
 	}
 }
 
-// Format the value as a string, including quotes for strings and list brackets for lists.
+bool ExecutableCommand::execute() const {
+	return invoke(presetArgs, slotPositions.empty() ? nullptr : slotPositions.data());
+}
+
+bool ExecutableCommand::executeWithArgs(std::initializer_list<std::pair<std::string, Value>> argsList) const {
+	const Command& cmd = getBaseCommand();
+	alignas(ARENA_ALIGNMENT) char buffer[EXECUTE_ARGS_BUFFER_SIZE];
+	Arena arena(buffer, sizeof(buffer));
+	size_t needed = argsList.size() * (sizeof(Argument) + sizeof(Value) + 2 * ARENA_ALIGNMENT) +
+		cmd.argSpecs.size() * sizeof(int) + 2 * ARENA_ALIGNMENT;
+	if (needed > sizeof(buffer))
+		arena.setBuffer(0, 0);
+	ArgumentList args((ArenaAllocator<Argument>(&arena)));
+	std::vector<int, ArenaAllocator<int> > slots(cmd.argSpecs.size(), -1, ArenaAllocator<int>(&arena));
+	args.reserve(argsList.size());
+	for (const auto& p : argsList) {
+		int slot = cmd.argSlot(p.first);
+		if (slot >= 0 && slots[slot] < 0)
+			slots[slot] = (int)args.size();
+		args.push_back(Argument(p.first, &arena));
+		args.back().values.reserve(1);
+		args.back().values.push_back(Value::borrow(p.second));
+	}
+	return invoke(args, slots.empty() ? nullptr : slots.data());
+}
+
+// Format the value as a string, including quotes for strings and brackets for lists, which may nest.
 static std::string formatValue(const Value& val) {
 	if (val.type == VAL_STRING) {
 		return "\"" + val.stringValue + "\"";
@@ -61,12 +108,7 @@ static std::string formatValue(const Value& val) {
 	else if (val.type == VAL_LIST) {
 		std::string listStr = "[";
 		for (size_t j = 0; j < val.listValue.size(); ++j) {
-			if (val.listValue[j].type == VAL_STRING) {
-				listStr += "\"" + val.listValue[j].stringValue + "\"";
-			}
-			else {
-				listStr += val.listValue[j].toString();
-			}
+			listStr += formatValue(val.listValue[j]);
 			if (j < val.listValue.size() - 1)
 				listStr += ", ";
 		}
@@ -77,7 +119,7 @@ static std::string formatValue(const Value& val) {
 }
 
 std::string ExecutableCommand::toString() const {
-	std::string result = baseCommand.name;
+	std::string result = getBaseCommand().name;
 	for (const auto& arg : presetArgs) {
 		result += " -" + arg.name + " ";
 		for (size_t i = 0; i < arg.values.size(); i++) {
@@ -90,7 +132,7 @@ std::string ExecutableCommand::toString() const {
 }
 
 std::string ExecutableCommand::toStringWithArgs(std::initializer_list<std::pair<std::string, Value>> argsList) const {
-	std::string result = baseCommand.name;
+	std::string result = getBaseCommand().name;
 	for (const auto& p : argsList) {
 		result += " -" + p.first + " " + formatValue(p.second);
 	}
@@ -99,22 +141,100 @@ std::string ExecutableCommand::toStringWithArgs(std::initializer_list<std::pair<
 
 void ExecutableCommand::toOutputWithArgs(std::initializer_list<std::pair<std::string, Value>> argsList) const {
 	std::string cmdStr = toStringWithArgs(argsList);
-	CLIOutput* out = baseCommand.getOutput();
+	CLIOutput* out = getBaseCommand().getOutput();
 	if (out) {
 		out->println(cmdStr);
 	}
 }
 
+// Convert a preset value to the declared type as text input would read its printed form: ints
+// widen to doubles, scalars become strings, and strings are parsed as numbers or bools. Returns
+// false if the value cannot be read as that type.
+static bool fitSpecType(const Value& value, ValueType type, Value& out) {
+	if (type == VAL_NONE || value.type == type) {
+		out = Value::borrow(value);
+		return true;
+	}
+	if (type == VAL_STRING) {
+		if (value.type == VAL_NONE || value.type == VAL_LIST)
+			return false;
+		out = Value(value.toString());
+		return true;
+	}
+	Scalar scalar;
+	ScalarKind kind = SCALAR_NONE;
+	if (value.type == VAL_STRING)
+		kind = parseScalar(value.stringValue.c_str(), value.stringValue.length, scalar);
+	else if (value.type == VAL_INT) {
+		kind = SCALAR_INT;
+		scalar.intValue = value.intValue;
+	}
+	if (type == VAL_INT && kind == SCALAR_INT)
+		out = Value(scalar.intValue);
+	else if (type == VAL_DOUBLE && kind == SCALAR_INT)
+		out = Value((double)scalar.intValue);
+	else if (type == VAL_DOUBLE && kind == SCALAR_DOUBLE)
+		out = Value(scalar.doubleValue);
+	else if (type == VAL_BOOL && kind == SCALAR_BOOL)
+		out = Value(scalar.boolValue);
+	else
+		return false;
+	return true;
+}
+
+// Arguments are written in slot order, as the journal records them. The wire format addresses
+// arguments by slot, so extra arguments of a variadic command, which have none, are left out;
+// as with execute(), only the first of several presets for one slot is sent.
+bool ExecutableCommand::encode(WireWriter& writer) const {
+	if (!baseCommand || baseCommand->id == WIRE_NO_ID)
+		return false;
+	size_t argCount = 0;
+	for (size_t slot = 0; slot < slotPositions.size(); slot++) {
+		if (slotPositions[slot] >= 0)
+			argCount++;
+	}
+#ifdef USE_SUGGESTIONS
+	if (argCount < presetArgs.size() && !baseCommand->variadic) {
+		// Some preset has no ArgSpec; the command would reject it.
+		for (size_t i = 0; i < presetArgs.size(); i++) {
+			if (baseCommand->argSlot(presetArgs[i].name.text, presetArgs[i].name.length) < 0)
+				return false;
+		}
+	}
+#endif
+	writer.beginCommand(baseCommand->id, argCount);
+	for (size_t slot = 0; slot < slotPositions.size(); slot++) {
+		if (slotPositions[slot] < 0)
+			continue;
+		const Argument& arg = presetArgs[slotPositions[slot]];
+		writer.beginArgument(slot, arg.values.size());
+		for (size_t i = 0; i < arg.values.size(); i++) {
+			Value value;
+			if (!fitSpecType(arg.values[i], baseCommand->argSpecs[slot].type, value))
+				return false;
+			writer.value(value);
+		}
+	}
+	return writer.ok();
+}
+
+size_t ExecutableCommand::encode(uint8_t* out, size_t size) const {
+	WireWriter writer(out, size);
+	writer.beginFrame();
+	return encode(writer) ? writer.size() : 0;
+}
+
 const Command& ExecutableCommand::getBaseCommand() const {
-	return baseCommand;
+	return baseCommand ? *baseCommand : noCommand();
 }
 
-std::vector<Argument> ExecutableCommand::getPresetArgs() const {
+const ArgumentList& ExecutableCommand::getPresetArgs() const {
 	return presetArgs;
 }
 
 void ExecutableCommand::setArgs(const std::vector<Argument>& presetArgs) {
-	this->presetArgs = presetArgs;
+	this->presetArgs.assign(presetArgs.begin(), presetArgs.end());
+	bindSlots();
 }
 
 void CommandSequence::addCommand(const ExecutableCommand& cmd) {
@@ -142,3 +262,13 @@ std::string CommandSequence::toString() const {
 	}
 	return result;
 }
+
+size_t CommandSequence::encode(uint8_t* out, size_t size) const {
+	WireWriter writer(out, size);
+	writer.beginFrame();
+	for (const auto& cmd : commands) {
+		if (!cmd.encode(writer))
+			return 0;
+	}
+	return writer.ok() ? writer.size() : 0;
+}
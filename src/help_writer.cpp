@@ -0,0 +1,58 @@
+// src/help_writer.cpp
+#include "help_writer.h"
+#include <cstring>
+
+static const char SPACES[] = "                                ";
+
+HelpWriter::HelpWriter(CLIOutput* out, size_t first, size_t count)
+	: output(out), offset(first), limit(count), lines(0), prefix(0), prefixLength(0), visible(false) {
+}
+
+void HelpWriter::setPrefix(const char* text, size_t length) {
+	prefix = text;
+	prefixLength = length;
+}
+
+void HelpWriter::line(size_t indent, const char* s, size_t length) {
+	beginLine(indent);
+	text(s, length);
+	endLine();
+}
+
+void HelpWriter::beginLine(size_t indent) {
+	size_t index = lines++;
+	visible = output && index >= offset && (limit == 0 || index - offset < limit);
+	if (visible && prefixLength > 0)
+		output->write(prefix, prefixLength);
+	while (visible && indent > 0) {
+		size_t n = indent < sizeof(SPACES) - 1 ? indent : sizeof(SPACES) - 1;
+		output->write(SPACES, n);
+		indent -= n;
+	}
+}
+
+void HelpWriter::text(const char* s, size_t length) {
+	if (visible)
+		output->write(s, length);
+}
+
+void HelpWriter::text(const char* s) {
+	if (visible)
+		output->write(s, std::strlen(s));
+}
+
+void HelpWriter::endLine() {
+	if (visible)
+		output->println();
+	visible = false;
+}
+
+void HelpWriter::block(size_t indent, const char* text, size_t length) {
+	size_t begin = 0;
+	while (begin < length) {
+		const char* end = static_cast<const char*>(std::memchr(text + begin, '\n', length - begin));
+		size_t lineEnd = end ? (size_t)(end - text) : length;
+		line(indent, text + begin, lineEnd - begin);
+		begin = lineEnd + 1;
+	}
+}
@@ -0,0 +1,62 @@
+// src/invocation.cpp
+#include "invocation.h"
+#include "command.h"
+#include "command_table.h"
+
+const Argument* Invocation::find(const std::string& name) const {
+	for (size_t i = 0; i < arguments.size(); i++) {
+		if (arguments[i].name == name)
+			return &arguments[i];
+	}
+	return 0;
+}
+
+const Value* Invocation::get(const std::string& name) const {
+	const Argument* arg = find(name);
+	if (!arg || arg->values.empty())
+		return 0;
+	return &arg->values[0];
+}
+
+const Value* Invocation::value(size_t slot) const {
+	size_t slotCount = command ? command->argSpecs.size() : tableCommand->argCount;
+	if (slot >= slotCount)
+		return 0;
+	if (!slotPositions)
+		return get(command->argSpecs[slot].name);
+	int position = slotPositions[slot];
+	if (position < 0 || arguments[position].values.empty())
+		return 0;
+	return &arguments[position].values[0];
+}
+
+int Invocation::getInt(size_t slot, int fallback) const {
+	const Value* v = value(slot);
+	return v && v->type == VAL_INT ? v->intValue : fallback;
+}
+
+double Invocation::getDouble(size_t slot, double fallback) const {
+	const Value* v = value(slot);
+	if (!v)
+		return fallback;
+	if (v->type == VAL_DOUBLE)
+		return v->doubleValue;
+	if (v->type == VAL_INT)
+		return (double)v->intValue;
+	return fallback;
+}
+
+bool Invocation::getBool(size_t slot, bool fallback) const {
+	const Value* v = value(slot);
+	return v && v->type == VAL_BOOL ? v->boolValue : fallback;
+}
+
+const char* Invocation::getString(size_t slot, const char* fallback) const {
+	const Value* v = value(slot);
+	return v && v->type == VAL_STRING ? v->stringValue.c_str() : fallback;
+}
+
+const ValueList* Invocation::getList(size_t slot) const {
+	const Value* v = value(slot);
+	return v && v->type == VAL_LIST ? &v->listValue : 0;
+}
@@ -0,0 +1,171 @@
+// src/lexer.cpp
+#include "lexer.h"
+#include <cctype>
+#include <cstring>
+
+bool Token::equals(const char* s) const {
+	size_t n = std::strlen(s);
+	return n == length && std::memcmp(data, s, n) == 0;
+}
+
+std::string Token::str() const {
+	std::string result;
+	appendTo(result);
+	return result;
+}
+
+void Token::appendTo(std::string& out) const {
+	size_t start = out.size();
+	out.resize(start + length);
+	out.resize(start + unquoteTo(&out[start]));
+}
+
+// Whether c, seen in state, belongs to the token's text once quotes and escapes are removed.
+// Inside lists everything is kept, since list items are unquoted when the list is parsed.
+static bool keepsChar(TokenizerState state, char c) {
+	if (state == TS_OUTSIDE)
+		return c != QUOTE_CHAR;
+	if (state == TS_IN_QUOTE)
+		return c != QUOTE_CHAR && c != ESCAPE_CHAR;
+	return true;
+}
+
+size_t Token::unquoteTo(char* out) const {
+	Token trimmed = Lexer::trim(*this);
+	if (!isQuoted()) {
+		std::memcpy(out, trimmed.data, trimmed.length);
+		return trimmed.length;
+	}
+	// Replay the tokenizer state machine, keeping only the characters that belong to the value.
+	size_t n = 0;
+	TokenizerState state = TS_OUTSIDE;
+	unsigned depth = 0;
+	for (size_t i = 0; i < length; i++) {
+		char c = data[i];
+		if (keepsChar(state, c))
+			out[n++] = c;
+		state = Lexer::splitStep(state, depth, c);
+	}
+	// Quoted text is trimmed like any other token.
+	size_t first = 0;
+	while (first < n && std::isspace((unsigned char)out[first]))
+		first++;
+	while (n > first && std::isspace((unsigned char)out[n - 1]))
+		n--;
+	if (first > 0)
+		std::memmove(out, out + first, n - first);
+	return n - first;
+}
+
+Token Lexer::trim(const Token& token) {
+	size_t start = 0;
+	while (start < token.length && std::isspace((unsigned char)token.data[start]))
+		start++;
+	size_t end = token.length;
+	while (end > start && std::isspace((unsigned char)token.data[end - 1]))
+		end--;
+	return Token(token.data + start, end - start, token.flags);
+}
+
+TokenizerState Lexer::splitStep(TokenizerState state, unsigned& depth, char c) {
+	switch (state) {
+	case TS_OUTSIDE:
+		if (c == QUOTE_CHAR)
+			return TS_IN_QUOTE;
+		if (c == LIST_START) {
+			depth = 1;
+			return TS_IN_LIST;
+		}
+		return TS_OUTSIDE;
+	case TS_IN_QUOTE:
+		if (c == ESCAPE_CHAR)
+			return TS_IN_ESCAPE;
+		return c == QUOTE_CHAR ? TS_OUTSIDE : TS_IN_QUOTE;
+	case TS_IN_ESCAPE:
+		return TS_IN_QUOTE;
+	case TS_IN_LIST:
+		if (c == QUOTE_CHAR)
+			return TS_IN_LIST_QUOTE;
+		if (c == LIST_START)
+			depth++;
+		else if (c == LIST_END && --depth == 0)
+			return TS_OUTSIDE;
+		return TS_IN_LIST;
+	case TS_IN_LIST_QUOTE:
+		if (c == ESCAPE_CHAR)
+			return TS_IN_LIST_ESCAPE;
+		return c == QUOTE_CHAR ? TS_IN_LIST : TS_IN_LIST_QUOTE;
+	default:
+		return TS_IN_LIST_QUOTE;
+	}
+}
+
+// Splits input string into separate commands using ';' as delimiter.
+bool Lexer::splitCommands(const char* input, size_t length, TokenList& out) {
+	size_t begin = 0;
+	TokenizerState state = TS_OUTSIDE;
+	unsigned depth = 0;
+	for (size_t i = 0; i <= length; i++) {
+		if (i == length || (state == TS_OUTSIDE && input[i] == COMMAND_DELIMITER)) {
+			Token span = trim(Token(input + begin, i - begin));
+			if (span.length > 0) {
+				if (!reserveRoom(out))
+					return false;
+				out.push_back(span);
+			}
+			begin = i + 1;
+			continue;
+		}
+		state = splitStep(state, depth, input[i]);
+	}
+	return true;
+}
+
+void Lexer::reset() {
+	state = TS_OUTSIDE;
+	depth = 0;
+	begin = 0;
+	content = 0;
+	flags = TOKEN_PLAIN;
+}
+
+bool Lexer::step(const char* input, size_t i, TokenList& out) {
+	char c = input[i];
+	if (state == TS_OUTSIDE) {
+		if (std::isspace((unsigned char)c)) {
+			bool appended = finish(input, i, out);
+			begin = i + 1;
+			return appended;
+		}
+		if (c == QUOTE_CHAR)
+			flags |= TOKEN_QUOTED;
+		else if (c == LIST_START && i == begin)
+			flags |= TOKEN_LIST;
+	}
+	if (keepsChar(state, c))
+		content++;
+	state = splitStep(state, depth, c);
+	return true;
+}
+
+bool Lexer::finish(const char* input, size_t position, TokenList& out) {
+	bool appended = true;
+	if (content > 0) {
+		appended = reserveRoom(out);
+		if (appended)
+			out.push_back(Token(input + begin, position - begin, flags));
+	}
+	begin = position;
+	content = 0;
+	flags = TOKEN_PLAIN;
+	return appended;
+}
+
+bool Lexer::tokenize(const char* input, size_t length, TokenList& out) {
+	Lexer lexer;
+	for (size_t i = 0; i < length; i++) {
+		if (!lexer.step(input, i, out))
+			return false;
+	}
+	return lexer.finish(input, length, out);
+}
@@ -0,0 +1,219 @@
+// src/scalar_parser.cpp
+#include "scalar_parser.h"
+#include <stdint.h>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#define SCALAR_MAX_DIGITS 19         // Decimal digits that always fit in a uint64_t
+#define SCALAR_EXACT_POW10 22        // Largest power of ten that is exact as a double
+#define SCALAR_EXACT_MANTISSA (1ULL << 53)
+#define SCALAR_SLOW_DIGITS 40        // Significant digits kept for the correctly rounded fallback
+#define SCALAR_MAX_EXPONENT 99999    // Exponents are clamped here; anything beyond is 0 or infinity anyway
+#define SCALAR_BUFFER_SIZE 64
+
+static const double POW10[SCALAR_EXACT_POW10 + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+static bool equalsIgnoreCase(const char* text, size_t length, const char* word) {
+	if (std::strlen(word) != length)
+		return false;
+	for (size_t i = 0; i < length; i++) {
+		char c = text[i];
+		if (c >= 'A' && c <= 'Z')
+			c = (char)(c - 'A' + 'a');
+		if (c != word[i])
+			return false;
+	}
+	return true;
+}
+
+// Hand the significant digits, without sign, to strtod as "<digits>e<exponent>". Writing no
+// decimal point keeps the result independent of the locale. Digits past SCALAR_SLOW_DIGITS are folded
+// into a final sticky '1' so rounding still sees that they were not zero.
+static double parseDoubleSlow(const char* text, size_t length) {
+	char buffer[SCALAR_BUFFER_SIZE];
+	size_t n = 0;
+	long exponent = 0;
+	bool sticky = false;
+	bool fraction = false;
+	size_t i = (text[0] == '-' || text[0] == '+') ? 1 : 0;
+	for (; i < length; i++) {
+		char c = text[i];
+		if (c == '.') {
+			fraction = true;
+			continue;
+		}
+		if (!isDigit(c))
+			break;
+		if (n == 0 && c == '0') {
+			if (fraction)
+				exponent--;
+			continue;
+		}
+		if (n < SCALAR_SLOW_DIGITS) {
+			buffer[n++] = c;
+			if (fraction)
+				exponent--;
+		}
+		else {
+			if (c != '0')
+				sticky = true;
+			if (!fraction)
+				exponent++;
+		}
+	}
+	if (sticky) {
+		buffer[n++] = '1';
+		exponent--;
+	}
+	if (i < length) {
+		// Exponent part; the caller has already validated its syntax.
+		i++;
+		bool expNegative = text[i] == '-';
+		if (text[i] == '-' || text[i] == '+')
+			i++;
+		long value = 0;
+		for (; i < length && value < SCALAR_MAX_EXPONENT; i++) {
+			value = value * 10 + (text[i] - '0');
+		}
+		exponent += expNegative ? -value : value;
+	}
+	if (n == 0)
+		return 0.0;
+	std::sprintf(buffer + n, "e%ld", exponent);
+	return std::strtod(buffer, 0);
+}
+
+ScalarKind parseScalar(const char* text, size_t length, Scalar& out) {
+	out.kind = SCALAR_NONE;
+	out.overflow = false;
+	if (length == 0)
+		return SCALAR_NONE;
+	if (length == 4 && std::memcmp(text, "true", 4) == 0) {
+		out.kind = SCALAR_BOOL;
+		out.boolValue = true;
+		return SCALAR_BOOL;
+	}
+	if (length == 5 && std::memcmp(text, "false", 5) == 0) {
+		out.kind = SCALAR_BOOL;
+		out.boolValue = false;
+		return SCALAR_BOOL;
+	}
+
+	size_t i = 0;
+	bool negative = false;
+	if (text[0] == '-' || text[0] == '+') {
+		negative = text[0] == '-';
+		i++;
+	}
+
+	// Accumulate up to SCALAR_MAX_DIGITS significant digits; `exponent` scales the mantissa.
+	uint64_t mantissa = 0;
+	int digits = 0;
+	long exponent = 0;
+	bool truncated = false; // A nonzero digit did not fit in the mantissa
+	size_t seen = 0;        // Digits in the integer and fraction parts, including zeros
+	for (; i < length && isDigit(text[i]); i++, seen++) {
+		unsigned d = (unsigned)(text[i] - '0');
+		if (digits == 0 && d == 0)
+			continue;
+		if (digits < SCALAR_MAX_DIGITS) {
+			mantissa = mantissa * 10 + d;
+			digits++;
+		}
+		else {
+			exponent++;
+			truncated |= d != 0;
+		}
+	}
+	bool integral = true;
+	if (i < length && text[i] == '.') {
+		integral = false;
+		for (i++; i < length && isDigit(text[i]); i++, seen++) {
+			unsigned d = (unsigned)(text[i] - '0');
+			if (digits == 0 && d == 0) {
+				exponent--;
+				continue;
+			}
+			if (digits < SCALAR_MAX_DIGITS) {
+				mantissa = mantissa * 10 + d;
+				digits++;
+				exponent--;
+			}
+			else {
+				truncated |= d != 0;
+			}
+		}
+	}
+	if (seen == 0) {
+		const char* word = text + i;
+		size_t wordLength = length - i;
+		if (equalsIgnoreCase(word, wordLength, "inf") || equalsIgnoreCase(word, wordLength, "infinity")) {
+			out.kind = SCALAR_DOUBLE;
+			out.doubleValue = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+			return SCALAR_DOUBLE;
+		}
+		if (equalsIgnoreCase(word, wordLength, "nan")) {
+			out.kind = SCALAR_DOUBLE;
+			out.doubleValue = negative ? -std::numeric_limits<double>::quiet_NaN() : std::numeric_limits<double>::quiet_NaN();
+			return SCALAR_DOUBLE;
+		}
+		return SCALAR_NONE;
+	}
+	if (i < length && (text[i] == 'e' || text[i] == 'E')) {
+		integral = false;
+		i++;
+		bool expNegative = false;
+		if (i < length && (text[i] == '-' || text[i] == '+')) {
+			expNegative = text[i] == '-';
+			i++;
+		}
+		size_t expStart = i;
+		long value = 0;
+		for (; i < length && isDigit(text[i]); i++) {
+			if (value < SCALAR_MAX_EXPONENT)
+				value = value * 10 + (text[i] - '0');
+		}
+		if (i == expStart)
+			return SCALAR_NONE;
+		exponent += expNegative ? -value : value;
+	}
+	if (i != length)
+		return SCALAR_NONE;
+
+	if (integral) {
+		uint64_t limit = negative ? (uint64_t)INT_MAX + 1 : (uint64_t)INT_MAX;
+		if (exponent == 0 && mantissa <= limit) {
+			out.kind = SCALAR_INT;
+			out.intValue = negative ? (int)(-(int64_t)mantissa) : (int)mantissa;
+			return SCALAR_INT;
+		}
+		out.overflow = true;
+	}
+
+	double value;
+	if (mantissa == 0) {
+		value = 0.0;
+	}
+	else if (!truncated && mantissa <= SCALAR_EXACT_MANTISSA &&
+		exponent >= -SCALAR_EXACT_POW10 && exponent <= SCALAR_EXACT_POW10) {
+		// Both operands are exact, so a single multiply or divide is correctly rounded.
+		value = (double)mantissa;
+		value = exponent < 0 ? value / POW10[-exponent] : value * POW10[exponent];
+	}
+	else {
+		value = parseDoubleSlow(text, length);
+	}
+	out.kind = SCALAR_DOUBLE;
+	out.doubleValue = negative ? -value : value;
+	return SCALAR_DOUBLE;
+}
@@ -0,0 +1,100 @@
+// src/script_runner.cpp
+#include "script_runner.h"
+#include "stream_parser.h"
+#ifdef RAPTORCLI_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+ScriptRunner::ScriptRunner(Dispatcher& dispatcher, ScriptMode mode)
+	: dispatcher(dispatcher), mode(mode), commands(0), succeeded(0) {
+}
+
+bool ScriptRunner::run(const char* input, size_t length) {
+	errors.clear();
+	dispatcher.batchMessages.clear();
+	commands = succeeded = 0;
+	size_t line = 1, lineStart = 0, begin = 0;
+	TokenizerState state = TS_OUTSIDE;
+	unsigned depth = 0;
+	for (size_t i = 0; i <= length; i++) {
+		bool lineEnd = i == length || input[i] == LINE_END;
+		if (lineEnd || (state == TS_OUTSIDE && input[i] == COMMAND_DELIMITER)) {
+			if (!runCommand(input, begin, i, line, lineStart) && mode == SCRIPT_STOP_ON_ERROR)
+				return false;
+			begin = i + 1;
+			if (lineEnd) {
+				// An unterminated quote or list does not carry over to the next line.
+				line++;
+				lineStart = i + 1;
+				state = TS_OUTSIDE;
+			}
+			continue;
+		}
+		state = Lexer::splitStep(state, depth, input[i]);
+	}
+	return errors.empty();
+}
+
+bool ScriptRunner::runCommand(const char* input, size_t begin, size_t end, size_t line, size_t lineStart) {
+	Token span = Lexer::trim(Token(input + begin, end - begin));
+	if (span.length == 0)
+		return true;
+	tokens.clear();
+	Lexer::tokenize(span.data, span.length, tokens);
+	DispatchResult result;
+	result.error = 0;
+	result.code = CLI_ERROR_NONE;
+	result.offset = CLI_ERROR_NO_POSITION;
+	{
+		Dispatcher::BatchScope scope(dispatcher, result);
+		result.success = dispatcher.dispatchTokens(tokens);
+	}
+	commands++;
+	if (result.success) {
+		succeeded++;
+		return true;
+	}
+	// Tokens passed to dispatchTokens are located from the first one, which starts the span.
+	ScriptError error;
+	error.offset = (size_t)(span.data - input);
+	if (result.offset != CLI_ERROR_NO_POSITION)
+		error.offset += result.offset;
+	error.line = line;
+	error.column = error.offset - lineStart + 1;
+	error.error = result.error;
+	error.code = result.code;
+	errors.push_back(error);
+	return false;
+}
+
+#ifdef RAPTORCLI_MMAP
+bool ScriptRunner::runFile(const char* path) {
+	errors.clear();
+	commands = succeeded = 0;
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		::close(fd);
+		return false;
+	}
+	size_t length = (size_t)st.st_size;
+	if (length == 0) {
+		::close(fd);
+		return true;
+	}
+	void* p = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED)
+		return false;
+	// The script is read once from start to end.
+	madvise(p, length, MADV_SEQUENTIAL);
+	bool success = run(static_cast<const char*>(p), length);
+	munmap(p, length);
+	return success;
+}
+#endif
@@ -0,0 +1,91 @@
+// src/stream_parser.cpp
+#include "stream_parser.h"
+#include "dispatcher.h"
+#include "RaptorCLI.h"
+#include <cctype>
+
+StreamParser::StreamParser(Dispatcher& dispatcher, size_t capacity)
+	: dispatcher(dispatcher), buffer(new char[capacity]), capacity(capacity), ownsBuffer(true) {
+	init();
+}
+
+StreamParser::StreamParser(Dispatcher& dispatcher, char* buffer, size_t capacity)
+	: dispatcher(dispatcher), buffer(buffer), capacity(capacity), ownsBuffer(false) {
+	init();
+}
+
+StreamParser::~StreamParser() {
+	if (ownsBuffer)
+		delete[] buffer;
+}
+
+void StreamParser::init() {
+	// Every token takes at least one byte plus a separator, so this bounds the token count.
+	tokens.reserve(capacity / 2 + 1);
+	reset();
+}
+
+void StreamParser::reset() {
+	length = 0;
+	discarding = false;
+	lexer.reset();
+	tokens.clear();
+}
+
+bool StreamParser::feed(const char* data, size_t n) {
+	bool success = true;
+	for (size_t i = 0; i < n; i++) {
+		if (!feed(data[i]))
+			success = false;
+	}
+	return success;
+}
+
+bool StreamParser::feed(char c) {
+	// A line end always ends the command, so an unterminated quote cannot swallow later lines.
+	if (c == LINE_END)
+		return endCommand();
+	if (discarding) {
+		if (c == COMMAND_DELIMITER)
+			return endCommand();
+		return true;
+	}
+	bool outside = lexer.getState() == TS_OUTSIDE;
+	if (outside && c == COMMAND_DELIMITER)
+		return endCommand();
+	if (outside && std::isspace((unsigned char)c)) {
+		// Separators are not stored; they only close the pending token.
+		lexer.finish(buffer, length, tokens);
+		return true;
+	}
+	if (length == capacity) {
+		discarding = true;
+#ifdef USE_COMMAND_STATS
+		dispatcher.recordError(0, STATS_ERROR_INPUT_TOO_LONG);
+#endif
+		CLIError error(CLI_ERROR_INPUT_TOO_LONG);
+		error.offset = length;
+		dispatcher.reportError(error);
+		return false;
+	}
+	buffer[length] = c;
+	lexer.step(buffer, length, tokens);
+	length++;
+	return true;
+}
+
+bool StreamParser::flush() {
+	return endCommand();
+}
+
+bool StreamParser::endCommand() {
+	// An overflowing command was already reported when it overflowed.
+	bool success = true;
+	if (!discarding) {
+		lexer.finish(buffer, length, tokens);
+		if (!tokens.empty())
+			success = dispatcher.dispatchTokens(tokens);
+	}
+	reset();
+	return success;
+}
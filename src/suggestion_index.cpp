@@ -0,0 +1,247 @@
+// src/suggestion_index.cpp
+#include "suggestion_index.h"
+#include "command_index.h"
+
+#define NO_LINK 0xFFFFFFFFu
+#define INITIAL_SLOTS 16
+#define MAX_NAME_LENGTH (SUGGEST_MAX_LENGTH + SUGGEST_MAX_DISTANCE)
+#define CHECKED_NAMES 64 // Names a lookup remembers having checked, so it checks each only once
+
+// Typos allowed for a token of the given length. A name is indexed with as many deletions as a
+// token of its own length allows, which covers every token within reach of it.
+static size_t typosFor(size_t length) {
+	if (length < 3)
+		return 0;
+	return length < 7 ? 1 : SUGGEST_MAX_DISTANCE;
+}
+
+// The deletions of one name hash to nearby FNV values, so mix the bits before masking.
+static size_t slotOf(uint32_t hash, size_t mask) {
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6Bu;
+	hash ^= hash >> 13;
+	return hash & mask;
+}
+
+// Optimal string alignment distance between a and b, counting a swap of adjacent characters as
+// one typo. Stops as soon as it exceeds limit and then returns limit + 1. Both lengths must be
+// at most MAX_NAME_LENGTH.
+static size_t distance(const char* a, size_t aLength, const char* b, size_t bLength, size_t limit) {
+	size_t rows[3][MAX_NAME_LENGTH + 1];
+	size_t* before = rows[0];
+	size_t* previous = rows[1];
+	size_t* current = rows[2];
+	for (size_t j = 0; j <= bLength; j++) {
+		previous[j] = j;
+	}
+	for (size_t i = 1; i <= aLength; i++) {
+		current[0] = i;
+		size_t best = i;
+		for (size_t j = 1; j <= bLength; j++) {
+			size_t d = previous[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1);
+			if (previous[j] + 1 < d)
+				d = previous[j] + 1;
+			if (current[j - 1] + 1 < d)
+				d = current[j - 1] + 1;
+			if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1] && before[j - 2] + 1 < d)
+				d = before[j - 2] + 1;
+			current[j] = d;
+			if (d < best)
+				best = d;
+		}
+		if (best > limit)
+			return limit + 1;
+		size_t* spare = before;
+		before = previous;
+		previous = current;
+		current = spare;
+	}
+	return previous[bLength] > limit ? limit + 1 : previous[bLength];
+}
+
+struct SuggestionIndex::Lookup {
+	const char* token;
+	size_t length;
+	size_t limit;
+	uint32_t checked[CHECKED_NAMES];
+	size_t checkedCount;
+	size_t distances[SUGGEST_MAX];
+	uint32_t ids[SUGGEST_MAX];
+	uint32_t positions[SUGGEST_MAX];
+	Suggestions* out;
+
+	// Return true if name id was checked before, and remember it otherwise.
+	bool seen(uint32_t id) {
+		for (size_t i = 0; i < checkedCount; i++) {
+			if (checked[i] == id)
+				return true;
+		}
+		if (checkedCount < CHECKED_NAMES)
+			checked[checkedCount++] = id;
+		return false;
+	}
+
+	// Keep name id, d typos away, if it is among the best so far; one name per item.
+	void offer(uint32_t id, const char* name, uint32_t position, size_t d) {
+		size_t slot = out->count;
+		for (size_t i = 0; i < out->count; i++) {
+			if (positions[i] == position) {
+				slot = i;
+				break;
+			}
+		}
+		if (slot < out->count && !better(d, id, slot))
+			return;
+		if (slot == out->count) {
+			if (out->count == SUGGEST_MAX && !better(d, id, SUGGEST_MAX - 1))
+				return;
+			slot = out->count < SUGGEST_MAX ? out->count++ : SUGGEST_MAX - 1;
+		}
+		// Move the new entry up past the entries it beats.
+		while (slot > 0 && better(d, id, slot - 1)) {
+			distances[slot] = distances[slot - 1];
+			ids[slot] = ids[slot - 1];
+			positions[slot] = positions[slot - 1];
+			out->names[slot] = out->names[slot - 1];
+			slot--;
+		}
+		distances[slot] = d;
+		ids[slot] = id;
+		positions[slot] = position;
+		out->names[slot] = name;
+	}
+
+	bool better(size_t d, uint32_t id, size_t slot) const {
+		return d < distances[slot] || (d == distances[slot] && id < ids[slot]);
+	}
+};
+
+SuggestionIndex::SuggestionIndex() : used(0) {}
+
+void SuggestionIndex::insert(const char* name, size_t length, uint32_t position) {
+	// Names too long to be within reach of any token that gets suggestions are left out.
+	if (length == 0 || length > MAX_NAME_LENGTH)
+		return;
+	uint32_t id = (uint32_t)names.size();
+	Name entry = { (uint32_t)text.size(), (uint32_t)length, position };
+	names.push_back(entry);
+	text.append(name, length);
+	text.push_back('\0');
+	insertDeletions(name, length, 0, typosFor(length), id);
+}
+
+void SuggestionIndex::insertDeletions(const char* s, size_t length, size_t from, size_t deletions, uint32_t name) {
+	insertLink(CommandIndex::hash(s, length), name);
+	if (deletions == 0)
+		return;
+	char shorter[MAX_NAME_LENGTH];
+	for (size_t i = from; i < length; i++) {
+		for (size_t j = 0, k = 0; j < length; j++) {
+			if (j != i)
+				shorter[k++] = s[j];
+		}
+		insertDeletions(shorter, length - 1, i, deletions - 1, name);
+	}
+}
+
+void SuggestionIndex::insertLink(uint32_t hash, uint32_t name) {
+	// Keep the load factor at or below one half, as CommandIndex does.
+	if ((used + 1) * 2 > slots.size())
+		rebuild(slots.empty() ? INITIAL_SLOTS : slots.size() * 2);
+	size_t mask = slots.size() - 1;
+	size_t i = slotOf(hash, mask);
+	while (slots[i].head != NO_LINK && slots[i].hash != hash)
+		i = (i + 1) & mask;
+	if (slots[i].head == NO_LINK) {
+		slots[i].hash = hash;
+		used++;
+	}
+	// Deleting either of two equal neighbours gives the same string; a name's own links are
+	// the newest, so a repeat is found at the head.
+	else if (links[slots[i].head].name == name) {
+		return;
+	}
+	Link link = { name, slots[i].head };
+	slots[i].head = (uint32_t)links.size();
+	links.push_back(link);
+}
+
+void SuggestionIndex::rebuild(size_t size) {
+	std::vector<Slot> old;
+	old.swap(slots);
+	Slot empty = { 0, NO_LINK };
+	slots.assign(size, empty);
+	size_t mask = size - 1;
+	for (size_t i = 0; i < old.size(); i++) {
+		if (old[i].head == NO_LINK)
+			continue;
+		size_t j = slotOf(old[i].hash, mask);
+		while (slots[j].head != NO_LINK)
+			j = (j + 1) & mask;
+		slots[j] = old[i];
+	}
+}
+
+void SuggestionIndex::suggest(const char* token, size_t length, Suggestions& out) const {
+	out.count = 0;
+	size_t limit = typosFor(length);
+	if (length > SUGGEST_MAX_LENGTH || limit == 0 || slots.empty())
+		return;
+	Lookup lookup;
+	lookup.token = token;
+	lookup.length = length;
+	lookup.limit = limit;
+	lookup.checkedCount = 0;
+	lookup.out = &out;
+	findDeletions(token, length, 0, limit, lookup);
+}
+
+void SuggestionIndex::findDeletions(const char* s, size_t length, size_t from, size_t deletions, Lookup& lookup) const {
+	uint32_t hash = CommandIndex::hash(s, length);
+	size_t mask = slots.size() - 1;
+	size_t i = slotOf(hash, mask);
+	while (slots[i].head != NO_LINK && slots[i].hash != hash)
+		i = (i + 1) & mask;
+	for (uint32_t l = slots[i].head; l != NO_LINK; l = links[l].next) {
+		uint32_t id = links[l].name;
+		const Name& name = names[id];
+		if (name.length + lookup.limit < lookup.length || lookup.length + lookup.limit < name.length || lookup.seen(id))
+			continue;
+		const char* candidate = text.data() + name.offset;
+		size_t d = distance(lookup.token, lookup.length, candidate, name.length, lookup.limit);
+		if (d <= lookup.limit)
+			lookup.offer(id, candidate, name.position, d);
+	}
+	if (deletions == 0)
+		return;
+	char shorter[SUGGEST_MAX_LENGTH];
+	for (size_t i = from; i < length; i++) {
+		for (size_t j = 0, k = 0; j < length; j++) {
+			if (j != i)
+				shorter[k++] = s[j];
+		}
+		findDeletions(shorter, length - 1, i, deletions - 1, lookup);
+	}
+}
+
+void SuggestionIndex::clear() {
+	text.clear();
+	names.clear();
+	slots.clear();
+	links.clear();
+	used = 0;
+}
+
+void SuggestionIndex::shrinkToFit() {
+	std::string(text).swap(text);
+	names.shrink_to_fit();
+	links.shrink_to_fit();
+	if (used == 0) {
+		std::vector<Slot>().swap(slots);
+		return;
+	}
+	size_t size = INITIAL_SLOTS;
+	while (size < used * 2)
+		size *= 2;
+	rebuild(size);
+}
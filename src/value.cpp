@@ -0,0 +1,296 @@
+// src/value.cpp
+#include "value.h"
+#include "arena.h"
+#include <cstring>
+#include <new>
+
+#define LIST_MIN_CAPACITY 4
+
+const char* valueTypeName(ValueType type) {
+	switch (type) {
+	case VAL_INT: return "int";
+	case VAL_DOUBLE: return "double";
+	case VAL_BOOL: return "bool";
+	case VAL_STRING: return "string";
+	case VAL_LIST: return "list";
+	default: return "unknown";
+	}
+}
+
+bool ValueString::operator==(const char* s) const {
+	size_t n = std::strlen(s);
+	return n == length && std::memcmp(c_str(), s, n) == 0;
+}
+
+bool ValueString::operator==(const std::string& s) const {
+	return s.size() == length && std::memcmp(c_str(), s.data(), length) == 0;
+}
+
+ValueList::operator std::vector<Value>() const {
+	return std::vector<Value>(items, items + count);
+}
+
+Value::Value(const char* v) : type(VAL_STRING), storage(STORAGE_HEAP) {
+	assignString(v, std::strlen(v), 0);
+}
+
+Value::Value(const std::vector<Value>& v) : type(VAL_LIST), storage(STORAGE_HEAP) {
+	clearPayload();
+	reserveList(v.size(), 0);
+	for (size_t i = 0; i < v.size(); i++) {
+		append(v[i]);
+	}
+}
+
+Value::Value(const Value& other) : type(VAL_NONE), storage(STORAGE_HEAP) {
+	copyFrom(other);
+}
+
+Value::Value(Value&& other) noexcept : type(VAL_NONE), storage(STORAGE_HEAP) {
+	moveFrom(other);
+}
+
+// other may live inside this value, e.g. `v = v.listValue[0]`, so it is copied or moved out
+// before this value's payload is released.
+Value& Value::operator=(const Value& other) {
+	if (this != &other) {
+		Value copy(other);
+		release();
+		moveFrom(copy);
+	}
+	return *this;
+}
+
+Value& Value::operator=(Value&& other) noexcept {
+	if (this != &other) {
+		Value taken(std::move(other));
+		release();
+		moveFrom(taken);
+	}
+	return *this;
+}
+
+Value Value::list(size_t capacity, Arena* arena) {
+	Value result;
+	result.type = VAL_LIST;
+	if (!result.reserveList(capacity, arena))
+		result.type = VAL_NONE;
+	return result;
+}
+
+Value Value::borrow(const Value& other) {
+	Value result;
+	result.type = other.type;
+	std::memcpy(&result.stringValue, &other.stringValue, sizeof(result.stringValue));
+	if (other.type == VAL_STRING || other.type == VAL_LIST)
+		result.storage = STORAGE_BORROWED;
+	return result;
+}
+
+Value Value::borrowString(const char* s, size_t length) {
+	Value result;
+	result.type = VAL_STRING;
+	result.stringValue.length = (uint32_t)length;
+	if (result.stringValue.isInline()) {
+		std::memcpy(result.stringValue.inlineData, s, length);
+		result.stringValue.inlineData[length] = '\0';
+	}
+	else {
+		result.stringValue.setHeapData(const_cast<char*>(s));
+		result.storage = STORAGE_BORROWED;
+	}
+	return result;
+}
+
+bool Value::append(const Value& item) {
+	return append(Value(item));
+}
+
+bool Value::append(Value&& item, Arena* arena) {
+	if (type != VAL_LIST)
+		return false;
+	// A borrowed list is copied into storage of its own before it is changed, even if the
+	// storage it points at has room to spare.
+	if (listValue.count == listValue.capacity) {
+		if (!reserveList(listValue.capacity < LIST_MIN_CAPACITY ? LIST_MIN_CAPACITY : listValue.capacity * 2, arena))
+			return false;
+	}
+	else if (storage == STORAGE_BORROWED) {
+		if (!reserveList(listValue.capacity, arena))
+			return false;
+	}
+	new (&listValue.items[listValue.count]) Value(std::move(item));
+	listValue.count++;
+	return true;
+}
+
+void Value::clearPayload() {
+	std::memset(&stringValue, 0, sizeof(stringValue) > sizeof(listValue) ? sizeof(stringValue) : sizeof(listValue));
+}
+
+// Allocate from the arena if one is given, otherwise from the heap. Returns a null pointer if
+// the arena is fixed and full; there is no fallback to the heap.
+static void* allocatePayload(size_t size, Arena* arena, unsigned char& storage) {
+	if (arena) {
+		storage = STORAGE_ARENA;
+		return arena->allocate(size);
+	}
+	storage = STORAGE_HEAP;
+	return ::operator new(size);
+}
+
+bool Value::assignString(const char* s, size_t length, Arena* arena) {
+	clearPayload();
+	storage = STORAGE_HEAP;
+	stringValue.length = (uint32_t)length;
+	char* target = stringValue.inlineData;
+	if (!stringValue.isInline()) {
+		target = static_cast<char*>(allocatePayload(length + 1, arena, storage));
+		if (!target) {
+			type = VAL_NONE;
+			storage = STORAGE_HEAP;
+			clearPayload();
+			return false;
+		}
+		stringValue.setHeapData(target);
+	}
+	std::memcpy(target, s, length);
+	target[length] = '\0';
+	return true;
+}
+
+// Grow the list storage, or give a borrowed list storage of its own, moving existing elements
+// into the new block.
+// Elements of a borrowed list are copied instead, since they belong to another value.
+// Returns false, leaving the list as it was, if the arena is full.
+bool Value::reserveList(size_t capacity, Arena* arena) {
+	if (capacity <= listValue.capacity && storage != STORAGE_BORROWED)
+		return true;
+	unsigned char newStorage = arena ? STORAGE_ARENA : STORAGE_HEAP;
+	Value* items = 0;
+	if (capacity > 0) {
+		items = static_cast<Value*>(allocatePayload(capacity * sizeof(Value), arena, newStorage));
+		if (!items)
+			return false;
+	}
+	for (uint32_t i = 0; i < listValue.count; i++) {
+		if (storage == STORAGE_BORROWED) {
+			new (&items[i]) Value(listValue.items[i]);
+		}
+		else {
+			new (&items[i]) Value(std::move(listValue.items[i]));
+			listValue.items[i].~Value();
+		}
+	}
+	if (storage == STORAGE_HEAP)
+		::operator delete(listValue.items);
+	listValue.items = items;
+	listValue.capacity = (uint32_t)capacity;
+	storage = newStorage;
+	return true;
+}
+
+void Value::copyFrom(const Value& other) {
+	type = other.type;
+	storage = STORAGE_HEAP;
+	switch (other.type) {
+	case VAL_STRING:
+		assignString(other.stringValue.c_str(), other.stringValue.length, 0);
+		break;
+	case VAL_LIST:
+		clearPayload();
+		reserveList(other.listValue.count, 0);
+		for (uint32_t i = 0; i < other.listValue.count; i++) {
+			append(other.listValue.items[i]);
+		}
+		break;
+	default:
+		std::memcpy(&stringValue, &other.stringValue, sizeof(stringValue));
+		break;
+	}
+}
+
+void Value::moveFrom(Value& other) {
+	type = other.type;
+	storage = other.storage;
+	std::memcpy(&stringValue, &other.stringValue, sizeof(stringValue));
+	// A moved-from value keeps its type but owns nothing.
+	if (other.type == VAL_STRING && !other.stringValue.isInline()) {
+		other.stringValue.length = 0;
+		other.stringValue.inlineData[0] = '\0';
+	}
+	else if (other.type == VAL_LIST) {
+		other.clearPayload();
+	}
+	other.storage = STORAGE_HEAP;
+}
+
+void Value::release() {
+	if (type == VAL_STRING && !stringValue.isInline()) {
+		if (storage == STORAGE_HEAP)
+			::operator delete(stringValue.heapData());
+	}
+	else if (type == VAL_LIST && storage != STORAGE_BORROWED) {
+		// Arena lists still destroy their elements, which may own heap memory.
+		for (uint32_t i = 0; i < listValue.count; i++) {
+			listValue.items[i].~Value();
+		}
+		if (storage == STORAGE_HEAP)
+			::operator delete(listValue.items);
+	}
+	type = VAL_NONE;
+	storage = STORAGE_HEAP;
+	clearPayload();
+}
+
+std::string Value::toString() const {
+	char buffer[32];
+	switch (type) {
+	case VAL_INT:
+		std::sprintf(buffer, "%d", intValue);
+		return std::string(buffer);
+	case VAL_DOUBLE:
+		std::sprintf(buffer, "%f", doubleValue);
+		return std::string(buffer);
+	case VAL_BOOL:
+		return boolValue ? BOOL_TRUE : BOOL_FALSE;
+	case VAL_STRING:
+		return stringValue.str();
+	case VAL_LIST: {
+		std::string result = "[";
+		for (size_t i = 0; i < listValue.size(); i++) {
+			result += listValue[i].toString();
+			if (i < listValue.size() - 1)
+				result += LIST_SEPARATOR;
+		}
+		result += "]";
+		return result;
+	}
+	default:
+		return "";
+	}
+}
+
+std::string operator+(const std::string& lhs, const ValueString& rhs) {
+	std::string result(lhs);
+	result.append(rhs.c_str(), rhs.length);
+	return result;
+}
+
+std::string operator+(const char* lhs, const ValueString& rhs) {
+	std::string result(lhs);
+	result.append(rhs.c_str(), rhs.length);
+	return result;
+}
+
+std::string operator+(const ValueString& lhs, const std::string& rhs) {
+	std::string result(lhs.c_str(), lhs.length);
+	result += rhs;
+	return result;
+}
+
+std::string operator+(const ValueString& lhs, const char* rhs) {
+	std::string result(lhs.c_str(), lhs.length);
+	result += rhs;
+	return result;
+}
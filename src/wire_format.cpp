@@ -0,0 +1,198 @@
+// src/wire_format.cpp
+#include "wire_format.h"
+#include <cstring>
+
+static uint32_t zigzag(int v) {
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int unzigzag(uint32_t v) {
+	return (int)((v >> 1) ^ (~(v & 1) + 1));
+}
+
+WireWriter::WireWriter(uint8_t* out, size_t size) : buffer(out), capacity(size), length(0), overflow(false) {
+}
+
+void WireWriter::byte(uint8_t b) {
+	if (length < capacity)
+		buffer[length++] = b;
+	else
+		overflow = true;
+}
+
+void WireWriter::varint(uint32_t v) {
+	while (v >= 0x80) {
+		byte((uint8_t)(v | 0x80));
+		v >>= 7;
+	}
+	byte((uint8_t)v);
+}
+
+void WireWriter::bytes(const void* data, size_t n) {
+	if (n > capacity - length) {
+		overflow = true;
+		return;
+	}
+	std::memcpy(buffer + length, data, n);
+	length += n;
+}
+
+void WireWriter::beginCommand(uint32_t id, size_t argCount) {
+	varint(id);
+	varint((uint32_t)argCount);
+}
+
+void WireWriter::beginArgument(size_t slot, size_t valueCount) {
+	bool many = valueCount != 1;
+	varint((uint32_t)(slot << 1) | (many ? 1 : 0));
+	if (many)
+		varint((uint32_t)valueCount);
+}
+
+void WireWriter::value(const Value& v) {
+	switch (v.type) {
+	case VAL_INT:
+		byte(WIRE_INT);
+		varint(zigzag(v.intValue));
+		break;
+	case VAL_DOUBLE: {
+		float narrow = (float)v.doubleValue;
+		if ((double)narrow == v.doubleValue) {
+			uint32_t bits;
+			std::memcpy(&bits, &narrow, sizeof(bits));
+			byte(WIRE_FLOAT);
+			for (int i = 0; i < 4; i++)
+				byte((uint8_t)(bits >> (8 * i)));
+			break;
+		}
+		uint64_t bits;
+		std::memcpy(&bits, &v.doubleValue, sizeof(bits));
+		byte(WIRE_DOUBLE);
+		for (int i = 0; i < 8; i++)
+			byte((uint8_t)(bits >> (8 * i)));
+		break;
+	}
+	case VAL_BOOL:
+		byte(v.boolValue ? WIRE_TRUE : WIRE_FALSE);
+		break;
+	case VAL_STRING:
+		byte(WIRE_STRING);
+		varint(v.stringValue.length);
+		bytes(v.stringValue.data(), v.stringValue.length);
+		break;
+	case VAL_LIST: {
+		bool packed = !v.listValue.empty();
+		for (size_t i = 0; i < v.listValue.size() && packed; i++)
+			packed = v.listValue[i].type == VAL_INT;
+		byte(packed ? WIRE_INT_LIST : WIRE_LIST);
+		varint((uint32_t)v.listValue.size());
+		for (size_t i = 0; i < v.listValue.size(); i++) {
+			if (packed)
+				varint(zigzag(v.listValue[i].intValue));
+			else
+				value(v.listValue[i]);
+		}
+		break;
+	}
+	default:
+		byte(WIRE_NONE);
+		break;
+	}
+}
+
+bool WireReader::byte(uint8_t& out) {
+	if (position >= length)
+		return false;
+	out = data[position++];
+	return true;
+}
+
+bool WireReader::varint(uint32_t& out) {
+	out = 0;
+	for (unsigned i = 0; i < WIRE_MAX_VARINT_BYTES; i++) {
+		uint8_t b;
+		if (!byte(b))
+			return false;
+		// The last byte only has room for the top 4 bits of a 32-bit value.
+		if (i == WIRE_MAX_VARINT_BYTES - 1 && b > 0x0F)
+			return false;
+		out |= (uint32_t)(b & 0x7F) << (7 * i);
+		if (!(b & 0x80))
+			return true;
+	}
+	return false;
+}
+
+bool WireReader::value(Value& out, Arena* arena, unsigned depth) {
+	uint8_t tag;
+	uint32_t n;
+	if (!byte(tag))
+		return false;
+	switch (tag) {
+	case WIRE_NONE:
+		out = Value();
+		return true;
+	case WIRE_FALSE:
+	case WIRE_TRUE:
+		out = Value(tag == WIRE_TRUE);
+		return true;
+	case WIRE_INT:
+		if (!varint(n))
+			return false;
+		out = Value(unzigzag(n));
+		return true;
+	case WIRE_DOUBLE: {
+		if (length - position < 8)
+			return false;
+		uint64_t bits = 0;
+		for (int i = 0; i < 8; i++)
+			bits |= (uint64_t)data[position++] << (8 * i);
+		double d;
+		std::memcpy(&d, &bits, sizeof(d));
+		out = Value(d);
+		return true;
+	}
+	case WIRE_FLOAT: {
+		if (length - position < 4)
+			return false;
+		uint32_t bits = 0;
+		for (int i = 0; i < 4; i++)
+			bits |= (uint32_t)data[position++] << (8 * i);
+		float f;
+		std::memcpy(&f, &bits, sizeof(f));
+		out = Value((double)f);
+		return true;
+	}
+	case WIRE_STRING:
+		if (!varint(n) || n > length - position)
+			return false;
+		out = Value(reinterpret_cast<const char*>(data + position), n, arena);
+		position += n;
+		return out.type == VAL_STRING;
+	case WIRE_LIST:
+	case WIRE_INT_LIST:
+		// Every element takes at least a byte, which bounds count before anything is allocated.
+		if (depth >= WIRE_MAX_DEPTH || !varint(n) || n > length - position)
+			return false;
+		out = Value::list(n, arena);
+		if (out.type != VAL_LIST)
+			return false;
+		for (uint32_t i = 0; i < n; i++) {
+			Value item;
+			if (tag == WIRE_INT_LIST) {
+				uint32_t v;
+				if (!varint(v))
+					return false;
+				item = Value(unzigzag(v));
+			}
+			else if (!value(item, arena, depth + 1)) {
+				return false;
+			}
+			if (!out.append(std::move(item), arena))
+				return false;
+		}
+		return true;
+	default:
+		return false;
+	}
+}